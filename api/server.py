@@ -1,9 +1,11 @@
 #!/usr/bin/env python3
 
 from flask import Flask
-from flask import request, jsonify, make_response
+from flask import g, request, jsonify, make_response
 from flask_cors import CORS
 
+import json
+import os
 import sys
 sys.path.append(r'../out/build/blockchain-server/lib/')
 import backend
@@ -11,6 +13,19 @@ import backend
 app = Flask(__name__)
 CORS(app)
 
+# every request is a trace span (recorded when the engine is built with ENABLE_TRACING),
+# so a trace shows the time spent in Flask around the engine spans
+@app.before_request
+def begin_request_span():
+    g.trace_span = backend.TraceSpan("flask " + request.method)
+    g.trace_span.__enter__()
+
+@app.teardown_request
+def end_request_span(error):
+    span = g.pop("trace_span", None)
+    if span is not None:
+        span.__exit__(None, None, None)
+
 @app.route('/', methods=['GET', 'POST'])
 def index():
     
@@ -38,10 +53,18 @@ def index():
             max_iter = req.get("maxiterations")
             parent_hash = req.get("parent")
             
-            if (blockchain.check_block_parent(parent_hash)):
+            if node is not None and mining_difficulty != network_difficulty:
+                # blocks do not record their difficulty, peers check them against their own
+                response_body = {
+                    "error": "the difficulty is fixed at " + str(network_difficulty) + " for a networked node"
+                }
+            elif (blockchain.check_block_parent(parent_hash)):
                 blockchain.set_difficulty(mining_difficulty)
                 blockchain.set_max_iterations(max_iter)
-                if (blockchain.mine_block(datastr)):
+                # the span around the call minus the engine spans is the cost of crossing the bindings
+                with backend.TraceSpan("server mine_block"):
+                    mined = miner.mine_block(datastr)
+                if (mined):
                     response_body = {
                         "miningdifficulty": blockchain.get_difficulty(),
                         "maximumiterations": blockchain.get_max_iterations(),
@@ -63,14 +86,11 @@ def index():
         elif cmd == "check_block":
             datastr = req.get("data")
             parent_hash = req.get("parent")
-            hashstr = "junk"
             bid = req.get("blockid")
             nonce = req.get("nonce")
             timestamp = req.get("timestamp")
             
-            block = backend.Block(nonce, bid, timestamp, parent_hash, datastr, hashstr)
-            
-            if block.check_hash() == blockchain.get_block_hash(bid):
+            if blockchain.check_block(nonce, bid, timestamp, parent_hash, datastr):
                 response_body = {
                      "matches": "true"
                 }
@@ -87,6 +107,56 @@ def index():
                 response_body = {
                      "acceptable": "false"
                 }
+        elif cmd == "submit":
+            # queue a record, it is mined together with other pending records
+            if mempool.add(req.get("data"), req.get("priority", 0)):
+                response_body = {
+                     "accepted": "true",
+                     "pending": mempool.size()
+                }
+            else:
+                response_body = {
+                     "accepted": "false",
+                     "pending": mempool.size()
+                }
+        elif cmd == "mine_pending":
+            records = assembler.mine_next()
+            if records > 0:
+                if node is not None:
+                    node.announce()
+                response_body = {
+                    "records": records,
+                    "pending": mempool.size(),
+                    "blockid": blockchain.get_last_block_index(),
+                    "hash": blockchain.get_last_block_hash(),
+                    "nonce": blockchain.get_last_block_nonce(),
+                }
+            else:
+                response_body = {
+                    "error": "no pending records or max iterations exceeded",
+                    "pending": mempool.size()
+                }
+        elif cmd == "validate_chain":
+            response_body = {
+                "valid": "true" if blockchain.validate_chain() else "false"
+            }
+        elif cmd == "pool_stats":
+            response_body = backend.pool_stats()
+        elif cmd == "trace":
+            # Chrome trace-event JSON (open in chrome://tracing or https://ui.perfetto.dev)
+            response_body = json.loads(backend.trace_dump())
+            response_body["tracing"] = backend.tracing
+            if req.get("clear"):
+                backend.trace_clear()
+        elif cmd == "headers":
+            # hex of the fixed-size headers of a range of blocks (light clients)
+            start = req.get("start", 0)
+            count = min(req.get("count", 1000), 100000)
+            response_body = {
+                "commitment": blockchain.get_commitment().name,
+                "format": blockchain.get_format(),
+                "headers": blockchain.export_headers(start, count).hex()
+            }
         elif cmd == "get_difficulty":
             response_body = {
                 "miningdifficulty": blockchain.get_difficulty()
@@ -105,5 +175,30 @@ def index():
 
 if __name__ == '__main__':
 
-    blockchain = backend.Blockchain()     
+    # BLOCKCHAIN_COMMITMENT=digest mines blocks whose headers light clients can verify,
+    # BLOCKCHAIN_HASH picks the proof-of-work hash (sha256, double_sha256 or fnv1a for test chains)
+    commitment = os.environ.get("BLOCKCHAIN_COMMITMENT", "payload")
+    hash_function = os.environ.get("BLOCKCHAIN_HASH", "sha256")
+    blockchain = backend.Blockchain(backend.Commitment.__members__[commitment],
+                                    backend.HashFunction.__members__[hash_function])
+    miner = blockchain
+    node = None
+    mempool = backend.Mempool()
+    assembler = backend.BlockAssembler(blockchain, mempool)
+
+    # optional peer-to-peer block propagation between server processes:
+    #   BLOCKCHAIN_NODE_ADDRESS  address to serve blocks at, "unix:<path>" or "tcp:<host>:<port>"
+    #   BLOCKCHAIN_NODE_PEERS    comma separated peer addresses (synced from at startup, announced to after mining)
+    #   BLOCKCHAIN_DIFFICULTY    difficulty every peer mines at (fixed while networked, default 1)
+    node_address = os.environ.get("BLOCKCHAIN_NODE_ADDRESS")
+    if node_address:
+        network_difficulty = int(os.environ.get("BLOCKCHAIN_DIFFICULTY", "1"))
+        blockchain.set_difficulty(network_difficulty)
+        node = backend.Node(blockchain)
+        if not node.listen(node_address):
+            sys.exit("cannot listen at " + node_address)
+        for peer in filter(None, os.environ.get("BLOCKCHAIN_NODE_PEERS", "").split(",")):
+            node.add_peer(peer)
+            node.sync_from(peer)
+        miner = node
     app.run(debug=False, host='0.0.0.0')
@@ -0,0 +1,66 @@
+/* bench_check_block
+
+  Purpose: queries per second of the server's `check_block` path, comparing
+           the previous approach (build a Block, re-hash it and copy the stored
+           block for its hash) with Blockchain::check_block
+
+  Usage: bench_check_block [--blocks N] [--queries Q]
+*/
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+struct Query {
+    size_t nonce;
+    size_t index;
+    time_t timestamp;
+    std::string parent;
+    std::string data;
+};
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 10000)};
+    const auto nqueries{arg_or(argc, argv, "--queries", 200000)};
+
+    uint64_t state{7};
+    Blockchain blockchain(1700000000);
+    for (size_t i{1}; i <= nblocks; ++i) blockchain.mine(json_record(state), 1700000000 + 10 * i);
+
+    // client queries for random blocks, a quarter of them tampered with
+    std::vector<Query> queries;
+    queries.reserve(nqueries);
+    for (size_t q{0}; q < nqueries; ++q) {
+        const auto block{blockchain.get_block(1 + next_random(state) % nblocks)};
+        auto data{block.get_data()};
+        if (q % 4 == 3) data[data.size() / 2] ^= 0x01;
+        queries.push_back({block.get_nonce(), block.get_index(), block.get_timestamp(), block.get_parent_hash(), data});
+    }
+
+    size_t matches_before{0};
+    Stopwatch timer;
+    for (const auto& q : queries) {
+        const Block block(q.nonce, q.index, q.timestamp, q.parent, q.data, "junk");
+        matches_before += (block.check_hash() == blockchain.get_block(q.index).get_hash()) ? 1 : 0;
+    }
+    const auto before_qps{nqueries / timer.seconds()};
+
+    size_t matches_after{0};
+    timer.reset();
+    for (const auto& q : queries) {
+        matches_after += blockchain.check_block(q.nonce, q.index, q.timestamp, q.parent, q.data) ? 1 : 0;
+    }
+    const auto after_qps{nqueries / timer.seconds()};
+
+    std::cout << "blocks: " << nblocks << ", queries: " << nqueries << " (25% tampered)\n"
+              << std::fixed << std::setprecision(0)
+              << "before (Block::check_hash + get_block copy): " << std::setw(12) << before_qps << " queries/s\n"
+              << "after  (Blockchain::check_block):            " << std::setw(12) << after_qps << " queries/s\n"
+              << "speedup: " << std::setprecision(2) << after_qps / before_qps << "x\n";
+    if (matches_before != matches_after) std::cout << "result mismatch!\n";
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+/* bench_compression
+
+  Purpose: memory footprint and decode latency of block payload compression
+           on realistic (JSON) payloads
+
+  Usage: bench_compression [--blocks N] [--records R] [--samples S]
+*/
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 20000)};
+    const auto nrecords{arg_or(argc, argv, "--records", 4)};
+    const auto nsamples{arg_or(argc, argv, "--samples", 1000)};
+
+    // payloads are identical for every configuration
+    uint64_t state{42};
+    std::vector<std::string> payloads(nblocks);
+    size_t raw_bytes{0};
+    for (auto& payload : payloads) {
+        payload = "[";
+        for (size_t r{0}; r < nrecords; ++r) payload += (r ? "," : "") + json_record(state);
+        payload += "]";
+        raw_bytes += payload.size();
+    }
+
+    std::cout << "blocks: " << nblocks << ", mean payload: " << raw_bytes / nblocks << " B\n\n"
+              << std::setw(12) << "dictionary" << std::setw(16) << "stored bytes" << std::setw(10) << "ratio"
+              << std::setw(14) << "rss delta kB" << std::setw(16) << "decode ns/blk"
+              << std::setw(18) << "get_data ns/blk" << "\n";
+
+    for (const size_t dictionary_size : {size_t{0}, size_t{1024}, size_t{4096}, size_t{16384}}) {
+
+        const auto rss_before{current_rss_kb()};
+        Blockchain blockchain;
+
+        // mine a tenth of the chain raw, train on it, then mine the rest compressed
+        const auto warmup{nblocks / 10};
+        for (size_t i{0}; i < nblocks; ++i) {
+            if (i == warmup && dictionary_size > 0) blockchain.train_codec(nsamples, dictionary_size);
+            blockchain.mine(payloads[i]);
+        }
+        const auto rss_after{current_rss_kb()};
+
+        size_t stored_bytes{0};
+        for (size_t i{1}; i < blockchain.get_chain_length(); ++i) stored_bytes += blockchain.get_block(i).get_stored_size();
+
+        // decode latency of the codec alone (over the compressed part of the chain)
+        double decode_ns{0.0};
+        if (auto codec{blockchain.get_codec()}) {
+            std::vector<std::string> stored;
+            for (size_t i{warmup}; i < nblocks; ++i) stored.push_back(codec->compress(payloads[i]));
+            size_t checksum{0};
+            Stopwatch timer;
+            for (const auto& s : stored) checksum += codec->decompress(s).size();
+            decode_ns = timer.nanoseconds() / stored.size();
+            do_not_optimize(checksum);
+        }
+
+        // end-to-end accessor latency (block copy + lazy decompression)
+        size_t checksum{0};
+        Stopwatch timer;
+        for (size_t i{1}; i < blockchain.get_chain_length(); ++i) checksum += blockchain.get_block(i).get_data().size();
+        const auto get_data_ns{timer.nanoseconds() / nblocks};
+        if (checksum != raw_bytes) std::cout << "payload mismatch!\n";
+
+        std::cout << std::setw(12) << dictionary_size << std::setw(16) << stored_bytes
+                  << std::setw(10) << std::fixed << std::setprecision(3) << static_cast<double>(stored_bytes) / raw_bytes
+                  << std::setw(14) << rss_after - rss_before << std::setw(16) << std::setprecision(1) << decode_ns
+                  << std::setw(18) << get_data_ns << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/* bench_export
+
+  Purpose: bulk export of the chain fields and payloads (one call for the
+           whole chain) against reading them block by block (one call per
+           field and block, like the Python getters)
+
+  Usage: bench_export [--blocks N]
+*/
+#include <iomanip>
+#include <iostream>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 1000000)};
+
+    // chain to export (mined without proof of work)
+    uint64_t state{5};
+    Blockchain chain(1700000000);
+    for (size_t i{1}; i <= nblocks; ++i) chain.mine(json_record(state), 1700000000 + 10 * i);
+    const auto length{chain.get_chain_length()};
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    Stopwatch timer;
+    uint64_t checksum{0};
+    for (size_t i{0}; i < length; ++i) {
+        checksum += chain.get_block(i).get_index();
+        checksum += static_cast<uint64_t>(chain.get_block(i).get_timestamp());
+        checksum += chain.get_block(i).get_nonce();
+        checksum += chain.get_block_hash(i).size();
+    }
+    do_not_optimize(checksum);
+    std::cout << "block by block fields:   " << std::setw(10) << 1e3 * timer.seconds() << " ms\n";
+
+    timer.reset();
+    const auto columns{chain.export_columns(0, length)};
+    do_not_optimize(columns);
+    std::cout << "export_columns:          " << std::setw(10) << 1e3 * timer.seconds() << " ms ("
+              << length << " blocks)\n";
+
+    timer.reset();
+    size_t bytes{0};
+    for (size_t i{0}; i < length; ++i) bytes += chain.get_block(i).get_data().size();
+    do_not_optimize(bytes);
+    std::cout << "block by block payloads: " << std::setw(10) << 1e3 * timer.seconds() << " ms\n";
+
+    timer.reset();
+    const auto payloads{chain.export_payloads(0, length)};
+    do_not_optimize(payloads);
+    std::cout << "export_payloads:         " << std::setw(10) << 1e3 * timer.seconds() << " ms ("
+              << payloads.bytes.size() / 1024 << " kB)\n";
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+/* bench_hash_policy
+
+  Purpose: cost of each proof-of-work hash policy, a block hash on its own,
+           the nonce search (hashes/s at a difficulty), mining without proof
+           of work and validating the chain, the FNV-1a rows are close to the
+           cost of the engine around the hash
+
+  Usage: bench_hash_policy [--hashes H] [--blocks N] [--pow-blocks P] [--difficulty D]
+*/
+#include <iomanip>
+#include <iostream>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nhashes{arg_or(argc, argv, "--hashes", 1000000)};
+    const auto nblocks{arg_or(argc, argv, "--blocks", 200000)};
+    const auto npow{arg_or(argc, argv, "--pow-blocks", 50)};
+    const auto difficulty{arg_or(argc, argv, "--difficulty", 3)};
+
+    std::cout << "policy          calc_hash (ns)   search (Mhash/s)   mine d=0 (blocks/s)   validate (ms)\n" << std::fixed;
+    for (const auto function : {HashFunction::sha256, HashFunction::double_sha256, HashFunction::fnv1a}) {
+        with_hash_policy(function, [&](auto policy) {
+            using Hash = decltype(policy);
+            uint64_t state{3};
+            const std::string parent(64, 'a');
+            const auto data{json_record(state)};
+
+            // one block hash
+            size_t checksum{0};
+            for (size_t n{0}; n < nhashes / 10; ++n) checksum += Blockchain::calc_hash<Hash>(n, 1, 1700000000, parent, data)[0];
+            Stopwatch timer;
+            for (size_t n{0}; n < nhashes; ++n) checksum += Blockchain::calc_hash<Hash>(n, 1, 1700000000, parent, data)[0];
+            const auto hash_ns{timer.nanoseconds() / nhashes};
+            do_not_optimize(checksum);
+
+            // nonce search at the difficulty (every nonce tried is one hash)
+            Blockchain pow(1700000000, Blockchain::Commitment::payload, function);
+            pow.set_difficulty(difficulty);
+            pow.set_max_iterations(size_t{1} << 40);
+            size_t hashes{0};
+            timer.reset();
+            for (size_t i{1}; i <= npow; ++i) {
+                pow.mine(json_record(state), 1700000000 + 10 * i);
+                hashes += pow.get_end_of_chain().get_nonce() + 1;
+            }
+            const auto search_rate{hashes / timer.seconds() / 1e6};
+
+            // mining without proof of work (one hash per block) and validation
+            Blockchain chain(1700000000, Blockchain::Commitment::payload, function);
+            timer.reset();
+            for (size_t i{1}; i <= nblocks; ++i) chain.mine(json_record(state), 1700000000 + 10 * i);
+            const auto mine_rate{nblocks / timer.seconds()};
+            timer.reset();
+            const auto valid{chain.validate_chain()};
+            const auto validate_ms{1e3 * timer.seconds()};
+
+            std::cout << std::left << std::setw(14) << hash_function_name(function) << std::right << std::setprecision(1)
+                      << std::setw(16) << hash_ns << std::setw(19) << std::setprecision(2) << search_rate
+                      << std::setw(22) << std::setprecision(0) << mine_rate << std::setw(16) << std::setprecision(1)
+                      << validate_ms << (valid ? "" : " (INVALID)") << "\n" << std::flush;
+        });
+    }
+    return 0;
+}
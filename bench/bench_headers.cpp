@@ -0,0 +1,85 @@
+/* bench_headers
+
+  Purpose: light-client verification of a digest committed chain from its
+           headers alone (streamed from a file in batches) against full
+           validation of the chain with its data, the chain is mined and
+           validated in a child process, so the peak RSS of the verifier is
+           its own
+
+  Usage: bench_headers [--blocks N] [--batch B] [--difficulty D] [--dir D]
+*/
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 1000000)};
+    const auto batch{arg_or(argc, argv, "--batch", 65536)};
+    const auto difficulty{arg_or(argc, argv, "--difficulty", 1)};
+    std::string dir{"/tmp"};
+    for (int i{1}; i + 1 < argc; ++i) {
+        if (std::string{argv[i]} == "--dir") dir = argv[i + 1];
+    }
+    const auto path{dir + "/bench_headers_" + std::to_string(getpid())};
+
+    std::cout << std::fixed << std::setprecision(1) << std::flush;
+    const auto child{fork()};
+    if (child == 0) {
+        // full node: the chain with its data
+        uint64_t state{11};
+        Blockchain chain(1700000000, Blockchain::Commitment::digest);
+        chain.set_difficulty(difficulty);
+        for (size_t i{1}; i <= nblocks; ++i) chain.mine(json_record(state), 1700000000 + 10 * i);
+        Stopwatch timer;
+        const auto valid{chain.validate_chain()};
+        std::cout << "full validation:    " << std::setw(10) << 1e3 * timer.seconds() << " ms ("
+                  << (valid ? "valid" : "INVALID") << "), peak RSS " << peak_rss_kb() / 1024 << " MB\n";
+
+        timer.reset();
+        std::ofstream out(path, std::ios::binary);
+        for (size_t from{0}; from < chain.get_chain_length(); from += batch) {
+            std::string encoded;
+            for (const auto& header : chain.export_headers(from, batch)) header.encode(encoded);
+            out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        }
+        std::cout << "header export:      " << std::setw(10) << 1e3 * timer.seconds() << " ms\n" << std::flush;
+        _exit(0);
+    }
+    int status{0};
+    waitpid(child, &status, 0);
+
+    // light client: the headers only, one batch in memory at a time
+    Stopwatch timer;
+    std::ifstream in(path, std::ios::binary);
+    std::optional<BlockHeader> previous;
+    Blockchain::HeaderCheck total{0, 0.0};
+    std::string encoded(batch * BlockHeader::size, '\0');
+    std::vector<BlockHeader> headers;
+    for (;;) {
+        in.read(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        const auto size{static_cast<size_t>(in.gcount())};
+        if (size == 0) break;
+        headers.clear();
+        for (size_t pos{0}; pos + BlockHeader::size <= size;) headers.push_back(BlockHeader::decode(encoded, pos));
+        const auto check{Blockchain::verify_headers(headers, difficulty, previous)};
+        total.verified += check.verified;
+        total.work += check.work;
+        if (check.verified != headers.size()) break;
+        previous = headers.back();
+    }
+    const auto seconds{timer.seconds()};
+    std::cout << "header verification:" << std::setw(10) << 1e3 * seconds << " ms (" << total.verified << " of "
+              << nblocks + 1 << " headers, " << std::setprecision(0) << total.verified / seconds << " headers/s, work "
+              << std::setprecision(3) << std::scientific << total.work << std::fixed << std::setprecision(1)
+              << "), peak RSS " << peak_rss_kb() / 1024 << " MB\n";
+    std::remove(path.c_str());
+    return 0;
+}
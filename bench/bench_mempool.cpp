@@ -0,0 +1,92 @@
+/* bench_mempool
+
+  Purpose: lock contention of the mempool with many concurrent producers
+           (single adds and batched adds), and records mined per second when
+           every record is its own block versus assembled blocks
+
+  Usage: bench_mempool [--records N] [--producers P] [--batch B] [--mined M] [--difficulty D] [--block-bytes S]
+*/
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "mempool.hpp"
+
+// records are unique per producer (the counter prefix), so none are deduplicated
+auto make_records(const size_t& producer, const size_t& count) -> std::vector<std::string> {
+    uint64_t state{producer + 1};
+    std::vector<std::string> records;
+    records.reserve(count);
+    for (size_t i{0}; i < count; ++i) records.push_back(std::to_string(producer) + "/" + std::to_string(i) + json_record(state));
+    return records;
+}
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nrecords{arg_or(argc, argv, "--records", 400000)};
+    const auto max_producers{arg_or(argc, argv, "--producers", 16)};
+    const auto batch{arg_or(argc, argv, "--batch", 64)};
+    const auto nmined{arg_or(argc, argv, "--mined", 2000)};
+    const auto difficulty{arg_or(argc, argv, "--difficulty", 2)};
+    const auto block_bytes{arg_or(argc, argv, "--block-bytes", 8192)};
+
+    std::cout << "records: " << nrecords << ", hardware threads: " << std::thread::hardware_concurrency() << "\n"
+              << "producers      add (records/s)   add_batch(" << batch << ") (records/s)\n"
+              << std::fixed << std::setprecision(0);
+    for (size_t producers{1}; producers <= max_producers; producers *= 2) {
+        std::vector<std::vector<std::string>> inputs;
+        for (size_t p{0}; p < producers; ++p) inputs.push_back(make_records(p, nrecords / producers));
+
+        double rates[2];
+        for (size_t mode{0}; mode < 2; ++mode) {
+            Mempool mempool(size_t{1} << 30);
+            std::vector<std::thread> threads;
+            Stopwatch timer;
+            for (size_t p{0}; p < producers; ++p) {
+                threads.emplace_back([&, p]() {
+                    const auto& records{inputs[p]};
+                    if (mode == 0) {
+                        for (const auto& record : records) mempool.add(record, record.size() % 8);
+                        return;
+                    }
+                    for (size_t i{0}; i < records.size(); i += batch) {
+                        const std::vector<std::string> chunk(records.begin() + i, records.begin() + std::min(records.size(), i + batch));
+                        mempool.add_batch(chunk, i % 8);
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join();
+            rates[mode] = static_cast<double>(mempool.size()) / timer.seconds();
+        }
+        std::cout << std::setw(9) << producers << std::setw(20) << rates[0] << std::setw(30) << rates[1] << "\n";
+    }
+
+    // records mined per second (each proof of work covers one block)
+    const auto records{make_records(0, nmined)};
+    Blockchain single(1700000000);
+    single.set_difficulty(difficulty);
+    single.set_max_iterations(100000000);
+    Stopwatch timer;
+    for (const auto& record : records) single.mine(record);
+    const auto single_rate{nmined / timer.seconds()};
+
+    Blockchain assembled(1700000000);
+    assembled.set_difficulty(difficulty);
+    assembled.set_max_iterations(100000000);
+    Mempool mempool;
+    BlockAssembler assembler(assembled, mempool, block_bytes);
+    timer.reset();
+    mempool.add_batch(records);
+    size_t mined{0};
+    while (mined < nmined) mined += assembler.mine_next();
+    const auto assembled_rate{nmined / timer.seconds()};
+
+    std::cout << "\nmining " << nmined << " records at difficulty " << difficulty << "\n"
+              << "one block per record:      " << std::setw(12) << single_rate << " records/s (" << single.get_chain_length() - 1 << " blocks)\n"
+              << "assembled blocks (" << block_bytes << " B): " << std::setw(12) << assembled_rate << " records/s (" << assembled.get_chain_length() - 1 << " blocks)\n"
+              << "speedup: " << std::setprecision(2) << assembled_rate / single_rate << "x\n";
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+/* bench_pruning
+
+  Purpose: resident memory of a long-running chain without pruning, with old
+           payloads dropped and with old payloads spilled to a cold store, and
+           the cost of reading a cold payload back (each mode runs in its own
+           process, so the RSS figures do not mix)
+
+  Usage: bench_pruning [--blocks N] [--keep-depth D] [--reads R] [--dir D]
+*/
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 10000000)};
+    const auto keep_depth{arg_or(argc, argv, "--keep-depth", 1000)};
+    const auto nreads{arg_or(argc, argv, "--reads", 100000)};
+    std::string dir{"/tmp"};
+    for (int i{1}; i + 1 < argc; ++i) {
+        if (std::string{argv[i]} == "--dir") dir = argv[i + 1];
+    }
+    const auto cold_path{dir + "/bench_pruning_" + std::to_string(getpid())};
+
+    std::cout << "mode        blocks    RSS (MB)   in memory (MB)   cold (MB)   blocks/s\n" << std::fixed << std::flush;
+    for (const std::string mode : {"none", "drop", "cold"}) {
+        const auto child{fork()};
+        if (child != 0) {
+            int status{0};
+            waitpid(child, &status, 0);
+            continue;
+        }
+
+        // chain mined without proof of work, one JSON record per block
+        uint64_t state{7};
+        Blockchain chain(1700000000);
+        if (mode != "none") chain.set_pruning({keep_depth, size_t(-1), (mode == "cold") ? cold_path : ""});
+        Stopwatch timer;
+        for (size_t i{1}; i <= nblocks; ++i) {
+            chain.mine(json_record(state), 1700000000 + 10 * i);
+            if (i % std::max<size_t>(1, nblocks / 10) != 0 && i != nblocks) continue;
+            const auto stats{chain.get_payload_stats()};
+            const auto cold_bytes{(mode == "cold" && std::filesystem::exists(cold_path)) ? std::filesystem::file_size(cold_path) : 0};
+            std::cout << std::setw(4) << mode << std::setw(14) << i << std::setw(12) << std::setprecision(0)
+                      << current_rss_kb() / 1024.0 << std::setw(17) << std::setprecision(1) << stats.resident_bytes / 1048576.0
+                      << std::setw(12) << cold_bytes / 1048576.0 << std::setw(11) << std::setprecision(0) << i / timer.seconds()
+                      << "\n" << std::flush;
+        }
+        std::cout << std::setw(4) << mode << "  peak RSS " << peak_rss_kb() / 1024 << " MB";
+
+        if (mode == "cold") {
+            // payloads read back from the cold store (in the page cache after the run)
+            const auto length{chain.get_chain_length() - keep_depth};
+            size_t bytes{0};
+            timer.reset();
+            for (size_t r{0}; r < nreads; ++r) bytes += chain.get_block(1 + next_random(state) % (length - 1)).get_data().size();
+            do_not_optimize(bytes);
+            std::cout << ", cold get_data " << std::setprecision(0) << timer.nanoseconds() / nreads << " ns";
+            std::filesystem::remove(cold_path);
+        }
+        std::cout << "\n" << std::flush;
+        _exit(0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/* bench_sha256
+
+  Purpose: cycles per byte of the scalar SHA-256 core against the reference
+           implementation (preprocessed message, full 64 word schedule) for
+           short, medium and long messages
+
+  Usage: bench_sha256 [--bytes B] [--ghz G]
+
+  Note: cycles are read from the time stamp counter on x86-64, elsewhere they
+        are estimated from the elapsed time at the given clock rate (--ghz,
+        in tenths of GHz, 30 by default)
+*/
+#include <iomanip>
+#include <iostream>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "bench_utils.hpp"
+#include "sha256.hpp"
+
+// cycles spent in f() (per call), f is run until about bytes have been hashed
+template <typename F>
+auto cycles_per_call(const size_t& calls, [[maybe_unused]] const double& ghz, F&& f) -> double {
+    Stopwatch timer;
+#if defined(__x86_64__)
+    const auto start{__rdtsc()};
+    for (size_t i{0}; i < calls; ++i) f();
+    return static_cast<double>(__rdtsc() - start) / static_cast<double>(calls);
+#else
+    for (size_t i{0}; i < calls; ++i) f();
+    return timer.nanoseconds() * ghz / static_cast<double>(calls);
+#endif
+}
+
+auto main(int argc, char** argv) -> int {
+
+    const auto total{arg_or(argc, argv, "--bytes", 64 << 20)}; // bytes hashed per size
+    const auto ghz{static_cast<double>(arg_or(argc, argv, "--ghz", 30)) / 10.0};
+
+    std::cout << "message size   scalar core (cycles/byte)   reference (cycles/byte)   speedup\n"
+              << std::fixed << std::setprecision(2);
+    for (const size_t size : {size_t{64}, size_t{1024}, size_t{1} << 20}) {
+        std::string message(size, '\0');
+        uint64_t state{7};
+        for (auto& c : message) c = static_cast<char>(next_random(state));
+        const auto calls{std::max<size_t>(1, total / size)};
+
+        const auto core{cycles_per_call(calls, ghz, [&]() { do_not_optimize(SHA256::digest(message)); })};
+        // the reference is much slower, hash a tenth of the bytes
+        const auto reference{cycles_per_call(std::max<size_t>(1, calls / 10), ghz, [&]() {
+            do_not_optimize(SHA256(message).compute_reference_digest());
+        })};
+        if (SHA256::digest(message) != SHA256(message).compute_reference_digest()) std::cout << "digest mismatch!\n";
+
+        std::cout << std::setw(12) << size << std::setw(28) << core / static_cast<double>(size)
+                  << std::setw(26) << reference / static_cast<double>(size)
+                  << std::setw(10) << reference / core << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+/* bench_sync
+
+  Purpose: sync throughput (blocks per second) of a node catching up with a
+           peer, the chain is served by one node and downloaded by a fresh one
+           (header-first, parallel body download, pipelined validation)
+
+  Usage: bench_sync [--blocks N] [--connections C] [--tcp PORT]
+         (unix sockets unless a TCP port is given)
+*/
+#include <iomanip>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "bench_utils.hpp"
+#include "node.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nblocks{arg_or(argc, argv, "--blocks", 1000000)};
+    const auto connections{arg_or(argc, argv, "--connections", 4)};
+    const auto port{arg_or(argc, argv, "--tcp", 0)};
+    const auto address{port ? "tcp:127.0.0.1:" + std::to_string(port)
+                            : "unix:/tmp/bench_sync_" + std::to_string(getpid()) + ".sock"};
+
+    uint64_t state{11};
+    Blockchain source(1700000000);
+    source.set_difficulty(1);
+    Stopwatch timer;
+    for (size_t i{1}; i <= nblocks; ++i) source.mine(json_record(state), 1700000000 + 10 * i);
+    std::cout << "mined " << nblocks << " blocks in " << std::fixed << std::setprecision(2) << timer.seconds() << " s\n";
+
+    Node server(source);
+    if (!server.listen(address)) {
+        std::cerr << "cannot listen at " << address << "\n";
+        return 1;
+    }
+
+    Blockchain replica(1700000000);
+    replica.set_difficulty(1);
+    Node node(replica);
+    timer.reset();
+    const auto imported{node.sync_from(address, connections)};
+    const auto elapsed{timer.seconds()};
+
+    std::cout << "sync over " << address << " with " << connections << " body connections\n"
+              << "imported: " << imported << " blocks in " << elapsed << " s\n"
+              << std::setprecision(0)
+              << "throughput: " << imported / elapsed << " blocks/s\n"
+              << "peak rss: " << peak_rss_kb() << " kB\n";
+    if (replica.get_end_of_chain().get_hash() != source.get_end_of_chain().get_hash()) {
+        std::cout << "tip mismatch!\n";
+        return 1;
+    }
+
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,68 @@
+/* bench_thread_pool
+
+  Purpose: scaling of the engine thread pool with the number of workers for
+           the parallel nonce search, chain validation and batched hashing,
+           with the pool instrumentation (steals, queue depth) of each run
+
+  Usage: bench_thread_pool [--threads T] [--blocks N] [--mined M] [--difficulty D] [--messages K]
+*/
+#include <iomanip>
+#include <iostream>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+#include "sha256_fixed.hpp"
+#include "thread_pool.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto max_threads{arg_or(argc, argv, "--threads", ThreadPool::available_cpus().size())};
+    const auto nblocks{arg_or(argc, argv, "--blocks", 200000)};
+    const auto nmined{arg_or(argc, argv, "--mined", 20)};
+    const auto difficulty{arg_or(argc, argv, "--difficulty", 4)};
+    const auto nmessages{arg_or(argc, argv, "--messages", 500000)};
+
+    // chain to validate (mined without proof of work)
+    uint64_t state{3};
+    Blockchain chain(1700000000);
+    for (size_t i{1}; i <= nblocks; ++i) chain.mine(json_record(state), 1700000000 + 10 * i);
+    std::vector<std::string> messages;
+    for (size_t i{0}; i < nmessages; ++i) messages.push_back(json_record(state));
+
+    std::cout << "available CPUs: " << ThreadPool::available_cpus().size() << ", NUMA nodes: " << ThreadPool::numa_nodes().size() << "\n"
+              << "threads   mining (hashes/s)   validation (blocks/s)   hashing (msgs/s)   steals   max depth\n"
+              << std::fixed << std::setprecision(0);
+    std::string reference_tip;
+    for (size_t threads{1}; threads <= max_threads; threads *= 2) {
+        ThreadPool::configure(threads);
+        const auto pool{ThreadPool::engine()};
+
+        Blockchain mining(1700000000);
+        mining.set_difficulty(difficulty);
+        mining.set_max_iterations(size_t{1} << 32);
+        size_t hashes{0};
+        Stopwatch timer;
+        for (size_t i{1}; i <= nmined; ++i) {
+            mining.mine("block " + std::to_string(i), 1700000000 + 10 * i);
+            hashes += mining.get_end_of_chain().get_nonce() + 1;
+        }
+        const auto mining_rate{hashes / timer.seconds()};
+        // the nonce search is deterministic, every pool size mines the same chain
+        if (reference_tip.empty()) reference_tip = mining.get_end_of_chain().get_hash();
+        if (reference_tip != mining.get_end_of_chain().get_hash()) std::cout << "chain mismatch!\n";
+
+        timer.reset();
+        if (!chain.validate_chain()) std::cout << "invalid chain!\n";
+        const auto validation_rate{nblocks / timer.seconds()};
+
+        timer.reset();
+        do_not_optimize(SHA256Fixed::digest_batch(messages));
+        const auto hashing_rate{nmessages / timer.seconds()};
+
+        const auto stats{pool->get_stats()};
+        std::cout << std::setw(7) << threads << std::setw(20) << mining_rate << std::setw(24) << validation_rate
+                  << std::setw(19) << hashing_rate << std::setw(9) << stats.steals << std::setw(12) << stats.max_queue_depth << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+/* bench_trace
+
+  Purpose: cost of a recorded trace span (recording on and paused), the
+           overhead of a span around a block hash and the time to dump a
+           full ring buffer as Chrome trace-event JSON
+
+  Note: spans are recorded here with TraceSpan directly, so the figures do not
+        depend on ENABLE_TRACING (which decides whether the engine's own
+        TRACE_SPANs exist, without it they are compiled out)
+
+  Usage: bench_trace [--spans N] [--hashes H]
+*/
+#include <iomanip>
+#include <iostream>
+
+#include "bench_utils.hpp"
+#include "blockchain.hpp"
+#include "trace.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nspans{arg_or(argc, argv, "--spans", 10000000)};
+    const auto nhashes{arg_or(argc, argv, "--hashes", 1000000)};
+
+    std::cout << "engine spans compiled in: " << (Trace::compiled ? "yes" : "no") << "\n" << std::fixed << std::setprecision(1);
+
+    Stopwatch timer;
+    for (size_t i{0}; i < nspans; ++i) { const TraceSpan span("bench span"); }
+    std::cout << "span, recording:       " << std::setw(8) << timer.nanoseconds() / nspans << " ns\n";
+
+    Trace::set_recording(false);
+    timer.reset();
+    for (size_t i{0}; i < nspans; ++i) { const TraceSpan span("bench span"); }
+    std::cout << "span, paused:          " << std::setw(8) << timer.nanoseconds() / nspans << " ns\n";
+    Trace::set_recording(true);
+
+    const std::string parent(64, 'a');
+    const std::string data{"{\"type\":\"transfer\",\"amount\":125.50,\"currency\":\"EUR\"}"};
+    size_t checksum{0};
+    for (size_t n{0}; n < nhashes / 10; ++n) checksum += Blockchain::calc_hash(n, 1, 1700000000, parent, data)[0]; // warm up
+    timer.reset();
+    for (size_t n{0}; n < nhashes; ++n) checksum += Blockchain::calc_hash(n, 1, 1700000000, parent, data)[0];
+    const auto plain{timer.nanoseconds() / nhashes};
+    timer.reset();
+    for (size_t n{0}; n < nhashes; ++n) {
+        const TraceSpan span("bench calc_hash");
+        checksum += Blockchain::calc_hash(n, 1, 1700000000, parent, data)[0];
+    }
+    const auto traced{timer.nanoseconds() / nhashes};
+    do_not_optimize(checksum);
+    std::cout << "calc_hash:             " << std::setw(8) << plain << " ns\n"
+              << "calc_hash in a span:   " << std::setw(8) << traced << " ns (" << std::setprecision(1)
+              << 100.0 * (traced - plain) / plain << " %)\n";
+
+    timer.reset();
+    const auto trace{Trace::dump()};
+    std::cout << "dump:                  " << std::setw(8) << 1e3 * timer.seconds() << " ms ("
+              << trace.size() / 1024 << " kB of JSON)\n";
+
+    return 0;
+}
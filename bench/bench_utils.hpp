@@ -0,0 +1,79 @@
+#ifndef BENCH_UTILS_HEADER_FILE
+#define BENCH_UTILS_HEADER_FILE
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "sampling.hpp"
+
+/* Stopwatch
+
+  Purpose: wall clock timer for benchmarks
+*/
+struct Stopwatch {
+
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    auto reset() -> void { this->start = std::chrono::steady_clock::now(); }
+
+    auto seconds() const -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+    }
+
+    auto nanoseconds() const -> double { return 1e9 * this->seconds(); }
+
+    private:
+        std::chrono::steady_clock::time_point start;
+};
+
+// peak resident set size of the process in kB
+inline auto peak_rss_kb() -> long {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// current resident set size of the process in kB
+inline auto current_rss_kb() -> long {
+    std::ifstream statm("/proc/self/statm");
+    long pages{0}, resident{0};
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// keep the compiler from optimizing away a benchmarked result
+template <typename T>
+inline auto do_not_optimize(const T& value) -> void {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// read `--name value` from the command line (or return the default)
+inline auto arg_or(int argc, char** argv, const char* name, const size_t& fallback) -> size_t {
+    for (int i{1}; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) return std::strtoull(argv[i + 1], nullptr, 10);
+    }
+    return fallback;
+}
+
+// a realistic, repetitive JSON payload (a payment record)
+inline auto json_record(uint64_t& state) -> std::string {
+    static const char* currencies[]{"USD", "EUR", "GBP", "JPY"};
+    static const char* kinds[]{"transfer", "invoice", "refund", "payout"};
+    const auto r{next_random(state)};
+    return "{\"type\":\"" + std::string{kinds[r % 4]} +
+           "\",\"from\":\"acct-" + std::to_string(10000 + (r >> 8) % 5000) +
+           "\",\"to\":\"acct-" + std::to_string(10000 + (r >> 24) % 5000) +
+           "\",\"amount\":" + std::to_string((r >> 40) % 100000) + "." + std::to_string(10 + (r >> 16) % 90) +
+           ",\"currency\":\"" + currencies[(r >> 4) % 4] +
+           "\",\"memo\":\"reference " + std::to_string((r >> 12) % 1000000) +
+           "\",\"status\":\"confirmed\",\"version\":2}";
+}
+
+#endif // BENCH_UTILS_HEADER_FILE
@@ -0,0 +1,61 @@
+/* bench_wal
+
+  Purpose: appends per second to the write-ahead log for each durability level
+           and number of concurrent appenders, with the number of syncs the
+           group commit needed (compared with one sync per append)
+
+  Usage: bench_wal [--appends N] [--threads T] [--window-us W] [--record-bytes B] [--dir D]
+*/
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench_utils.hpp"
+#include "wal.hpp"
+
+auto main(int argc, char** argv) -> int {
+
+    const auto nappends{arg_or(argc, argv, "--appends", 4000)}; // per run
+    const auto max_threads{arg_or(argc, argv, "--threads", 16)};
+    const auto window{std::chrono::microseconds(arg_or(argc, argv, "--window-us", 500))};
+    const auto record_bytes{arg_or(argc, argv, "--record-bytes", 256)};
+    std::string dir{"/tmp"};
+    for (int i{1}; i + 1 < argc; ++i) {
+        if (std::string{argv[i]} == "--dir") dir = argv[i + 1];
+    }
+    const auto path{dir + "/bench_wal_" + std::to_string(getpid())};
+    const std::string record(record_bytes, 'r');
+
+    std::cout << "durability   threads   window (us)   appends/s   syncs   appends/sync\n" << std::fixed;
+    const std::pair<const char*, Durability> levels[]{{"none", Durability::none}, {"async", Durability::async}, {"sync", Durability::sync}};
+    for (const auto& [name, level] : levels) {
+        for (size_t threads{1}; threads <= max_threads; threads *= 4) {
+            // without a window, appends made during a commit share the next one
+            for (const auto run_window : {std::chrono::microseconds{0}, window}) {
+                std::filesystem::remove(path);
+                WriteAheadLog log(path, run_window);
+                Stopwatch timer;
+                std::vector<std::thread> appenders;
+                for (size_t t{0}; t < threads; ++t) {
+                    appenders.emplace_back([&, t]() {
+                        for (size_t i{t}; i < nappends; i += threads) log.append(record, level);
+                    });
+                }
+                for (auto& appender : appenders) appender.join();
+                log.sync(); // every run ends durable
+                const auto seconds{timer.seconds()};
+                const auto stats{log.get_stats()};
+                std::cout << std::setw(10) << name << std::setw(10) << threads << std::setw(14) << run_window.count()
+                          << std::setw(12) << std::setprecision(0) << nappends / seconds << std::setw(8) << stats.syncs
+                          << std::setw(15) << std::setprecision(1) << static_cast<double>(stats.appends) / std::max<size_t>(1, stats.syncs) << "\n";
+            }
+        }
+    }
+    std::filesystem::remove(path);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+/* fuzz_block
+
+  Purpose: fuzzing of the block encodings
+             - Block::deserialize on arbitrary bytes either throws
+               std::runtime_error or decodes blocks that serialize back to
+               the bytes they were decoded from
+             - blocks built from the input (raw or compressed with a
+               dictionary codec) survive a serialize / deserialize round trip
+             - the dictionary codec round-trips the input and rejects
+               malformed payloads with std::runtime_error
+*/
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "block.hpp"
+#include "codec.hpp"
+#include "fuzz_utils.hpp"
+
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) -> int {
+    const std::string input(reinterpret_cast<const char*>(data), size);
+
+    // decoding arbitrary bytes
+    size_t pos{0};
+    try {
+        while (pos < input.size()) {
+            const auto start{pos};
+            const auto block{Block::deserialize(input, pos)};
+            fuzz_check(pos > start && pos <= input.size(), "deserialize advances within the input", input);
+            fuzz_check(block.serialize() == input.substr(start, pos - start), "deserialize / serialize", input);
+        }
+    } catch (const std::runtime_error&) {
+        // malformed input is rejected
+    }
+
+    // round trip of blocks built from the input (the fields are cut out of it)
+    static const auto codec{std::make_shared<const DictionaryCodec>(
+        std::string{"{\"type\":\"transfer\",\"from\":\"acct-\",\"to\":\"acct-\",\"amount\":"})};
+    const auto cut{[&input](const size_t& at) { return input.substr(std::min(at, input.size())); }};
+    const auto third{input.size() / 3};
+    const auto parent{cut(0).substr(0, third)};
+    const auto data_field{cut(third)};
+    uint64_t nonce{0};
+    for (size_t i{0}; i < std::min<size_t>(8, input.size()); ++i) nonce = (nonce << 8) | static_cast<uint8_t>(input[i]);
+    for (const auto& block_codec : {std::shared_ptr<const Codec>{}, std::shared_ptr<const Codec>{codec}}) {
+        const Block block(nonce, input.size(), static_cast<time_t>(nonce >> 1), parent, data_field, "hash", block_codec);
+        fuzz_check(block.get_data() == data_field, "stored data", input);
+        const auto encoded{block.serialize()};
+        size_t at{0};
+        const auto decoded{Block::deserialize(encoded, at)};
+        fuzz_check(at == encoded.size(), "round trip consumes the encoding", input);
+        fuzz_check(decoded.get_index() == block.get_index() && decoded.get_nonce() == block.get_nonce() &&
+                   decoded.get_timestamp() == block.get_timestamp() && decoded.get_parent_hash() == parent &&
+                   decoded.get_hash() == "hash" && decoded.get_data() == data_field, "round trip fields", input);
+        fuzz_check(decoded.serialize() == encoded, "round trip encoding", input);
+    }
+
+    fuzz_check(codec->decompress(codec->compress(input)) == input, "dictionary codec round trip", input);
+    try {
+        do_not_discard(codec->decompress(input));
+    } catch (const std::runtime_error&) {
+        // malformed payload is rejected
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/* fuzz_main
+
+  Purpose: standalone driver for the fuzz targets when libFuzzer is not
+           available (e.g. gcc builds), runs the target on the given files
+           (or every file of the given directories, e.g. a libFuzzer corpus),
+           then on generated inputs whose lengths favour the SHA-256 padding
+           boundaries (55, 56, 63 and 64 bytes into a block)
+
+  Usage: fuzz_<target> [--runs N] [--seed S] [--max-len L] [file or directory ...]
+*/
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fuzz_utils.hpp"
+
+namespace {
+
+    // deterministic pseudo random numbers (splitmix64)
+    auto next_random(uint64_t& state) -> uint64_t {
+        uint64_t z{(state += 0x9e3779b97f4a7c15)};
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    auto run(const std::string& input) -> void {
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+
+    auto run_file(const std::filesystem::path& path) -> size_t {
+        std::ifstream file(path, std::ios::binary);
+        run(std::string{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()});
+        return 1;
+    }
+
+}
+
+auto main(int argc, char** argv) -> int {
+
+    size_t runs{100000}, max_len{4096};
+    uint64_t seed{1};
+    std::vector<std::string> paths;
+    for (int i{1}; i < argc; ++i) {
+        const std::string arg{argv[i]};
+        if ((arg == "--runs" || arg == "--seed" || arg == "--max-len") && i + 1 < argc) {
+            const auto value{std::strtoull(argv[++i], nullptr, 10)};
+            if (arg == "--runs") runs = value;
+            else if (arg == "--seed") seed = value;
+            else max_len = std::max<size_t>(1, value);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    size_t files{0};
+    for (const auto& path : paths) {
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file()) files += run_file(entry.path());
+            }
+        } else {
+            files += run_file(path);
+        }
+    }
+
+    // half of the generated inputs end on a padding boundary, the rest have any length
+    uint64_t state{seed};
+    std::string input;
+    for (size_t r{0}; r < runs; ++r) {
+        const auto random{next_random(state)};
+        static constexpr size_t boundaries[]{0, 1, 55, 56, 57, 63, 64, 65};
+        const auto len{(random & 1) ? std::min(max_len, 64 * ((random >> 8) % 6) + boundaries[(random >> 4) % 8])
+                                    : (random >> 8) % (max_len + 1)};
+        input.resize(len);
+        // mostly random bytes, sometimes a repeated byte (compressible, structured)
+        const auto fill{static_cast<char>(random >> 32)};
+        for (auto& c : input) c = (random & 2) ? fill : static_cast<char>(next_random(state));
+        run(input);
+    }
+
+    std::cout << "fuzz: " << files << " files and " << runs << " generated inputs passed\n";
+    return 0;
+}
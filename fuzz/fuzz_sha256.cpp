@@ -0,0 +1,68 @@
+/* fuzz_sha256
+
+  Purpose: differential fuzzing of the SHA-256 variants against the reference
+           implementation (the preprocessing of the standard, step by step):
+             - scalar core (SHA256::digest, SHA256::compute_digest)
+             - streaming, the scalar core fed whole blocks in two calls
+               (the intermediate hash value carried over like a midstate)
+             - constexpr generic hash (SHA256Fixed::hash)
+             - fixed-size kernels (SHA256Fixed::digest, hash_fixed<1..4>)
+
+  Note: besides the input itself, the input resized to the padding boundaries
+        of its block count (55, 56, 63 and 64 bytes into the last block) is
+        checked, whatever length the fuzzer picked
+*/
+#include <cstring>
+
+#include "fuzz_utils.hpp"
+#include "sha256.hpp"
+#include "sha256_fixed.hpp"
+
+// every variant of the message hash must match the reference
+auto check_variants(const std::string& msg) -> void {
+    SHA256 sha(msg);
+    const auto reference{sha.compute_reference_digest()};
+
+    fuzz_check(SHA256::digest(msg) == reference, "scalar core", msg);
+    fuzz_check(sha.compute_digest() == reference, "compute_digest", msg);
+    fuzz_check(SHA256Fixed::to_hex(SHA256Fixed::hash(msg)) == reference, "constexpr hash", msg);
+    fuzz_check(SHA256Fixed::digest(msg) == reference, "fixed-size kernels", msg);
+    const auto hash_fixed_digest{[&msg]() {
+        switch (SHA256Fixed::blocks_for(msg.size())) {
+            case 1: return SHA256Fixed::to_hex(SHA256Fixed::hash_fixed<1>(msg));
+            case 2: return SHA256Fixed::to_hex(SHA256Fixed::hash_fixed<2>(msg));
+            case 3: return SHA256Fixed::to_hex(SHA256Fixed::hash_fixed<3>(msg));
+            default: return SHA256Fixed::to_hex(SHA256Fixed::hash_fixed<4>(msg)); // falls back past 4 blocks
+        }
+    }};
+    fuzz_check(hash_fixed_digest() == reference, "hash_fixed", msg);
+
+    // whole blocks compressed at once or split in two calls (streaming)
+    const auto data{reinterpret_cast<const unsigned char*>(msg.data())};
+    const auto whole{msg.size() / 64};
+    uint32_t once[8], split[8];
+    // initial hash value (Section 5.3.3)
+    const uint32_t initial[8]{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::memcpy(once, initial, sizeof(once));
+    std::memcpy(split, initial, sizeof(split));
+    SHA256::compress(once, data, whole);
+    const auto first{whole / 2};
+    SHA256::compress(split, data, first);
+    SHA256::compress(split, data + 64 * first, whole - first);
+    fuzz_check(std::memcmp(once, split, sizeof(once)) == 0, "streaming compress", msg);
+}
+
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) -> int {
+    const std::string msg(reinterpret_cast<const char*>(data), size);
+    check_variants(msg);
+
+    // the padding boundaries of the last block of this input
+    const auto base{64 * (size / 64)};
+    const auto fill{size ? static_cast<char>(data[0]) : 'a'};
+    for (const size_t offset : {55, 56, 63, 64}) {
+        auto resized{msg};
+        resized.resize(base + offset, fill);
+        check_variants(resized);
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef FUZZ_UTILS_HEADER_FILE
+#define FUZZ_UTILS_HEADER_FILE
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// report a failed check (with the input length) and abort, so that both
+// libFuzzer and the standalone driver keep the offending input
+inline auto fuzz_check(const bool& ok, const char* what, const std::string& input) -> void {
+    if (ok) return;
+    std::cerr << "fuzz check failed: " << what << " (input of " << input.size() << " bytes)\n";
+    std::abort();
+}
+
+// keep the compiler from optimizing away a checked call
+template <typename T>
+inline auto do_not_discard(const T& value) -> void {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// the libFuzzer entry point every target defines
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t*, size_t) -> int;
+
+#endif // FUZZ_UTILS_HEADER_FILE
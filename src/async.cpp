@@ -0,0 +1,126 @@
+#include <stdexcept>
+#include <thread>
+
+#include "async.hpp"
+
+CancellationToken::CancellationToken() : state(std::make_shared<State>()) {
+}
+
+auto CancellationToken::cancel() const -> void {
+    this->state->cancelled = true;
+}
+
+auto CancellationToken::cancelled() const -> bool {
+    return this->state->cancelled ||
+           (this->state->deadline && std::chrono::steady_clock::now() >= *this->state->deadline);
+}
+
+auto CancellationToken::with_timeout(const std::chrono::steady_clock::duration& timeout) -> CancellationToken {
+    CancellationToken token;
+    token.state->deadline = std::chrono::steady_clock::now() + timeout;
+    return token;
+}
+
+/* mine_async
+
+  Purpose: mine a block without blocking the caller, the proof of work is
+           searched on the engine thread pool in slices of nonces, between
+           slices the coroutine yields (so that many concurrent requests share
+           the workers) and checks for cancellation
+
+  Parameters: blockchain, the chain to mine on (must outlive the task)
+              data, the block data
+              token, cancels the search (explicitly or by timeout)
+
+  Return: a task that yields true if the block was mined,
+          false if mining failed, was cancelled or timed out
+*/
+auto mine_async(Blockchain& blockchain, std::string data, CancellationToken token) -> Task<bool> {
+    constexpr size_t slice{2048}; // nonces between yields
+    const auto pool{ThreadPool::engine()};
+    co_await schedule_on(*pool);
+    auto job{blockchain.begin_mining(data, time(nullptr))};
+    while (!blockchain.continue_mining(job, slice)) {
+        if (token.cancelled()) co_return false;
+        co_await yield_to(*pool);
+    }
+    co_return !token.cancelled() && blockchain.complete_mining(job);
+}
+
+auto get_block_async(const Blockchain& blockchain, size_t index) -> Task<BlockView> {
+    const auto pool{ThreadPool::engine()};
+    co_await schedule_on(*pool);
+    const auto blocks{blockchain.get_blocks(index, 1)};
+    if (blocks.empty()) throw std::out_of_range("get_block_async: no block " + std::to_string(index));
+    const auto& block{blocks.front()};
+    co_return BlockView{block.get_index(), block.get_timestamp(), block.get_nonce(),
+                        block.get_parent_hash(), block.get_hash(), block.get_data()};
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Coroutine engine API") {
+    Blockchain blockchain;
+    blockchain.set_difficulty(2);
+
+    SUBCASE("tasks compose and can be waited for") {
+        const auto mine_two{[&blockchain]() -> Task<size_t> {
+            size_t mined{0};
+            mined += co_await mine_async(blockchain, "first") ? 1 : 0;
+            mined += co_await mine_async(blockchain, "second") ? 1 : 0;
+            const auto view{co_await get_block_async(blockchain, 2)};
+            co_return (view.data == "second") ? mined : 0;
+        }};
+        CHECK(mine_two().get() == 2);
+        const auto view{get_block_async(blockchain, 1).get()};
+        CHECK(view.index == 1);
+        CHECK(view.data == "first");
+        CHECK(view.hash == blockchain.get_block_hash(1));
+        CHECK(Blockchain::meets_difficulty(view.hash, 2));
+        CHECK_THROWS(get_block_async(blockchain, 99).get());
+    }
+    SUBCASE("many concurrent requests share the pool") {
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t done{0}, mined{0};
+        const size_t requests{32};
+        for (size_t r{0}; r < requests; ++r) {
+            mine_async(blockchain, "request " + std::to_string(r)).start([&](bool* result, std::exception_ptr) {
+                std::lock_guard lock(mutex);
+                mined += (result && *result) ? 1 : 0;
+                ++done;
+                finished.notify_all();
+            });
+        }
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&]() { return done == requests; });
+        // requests racing for the same tip may lose it, at least one always wins
+        CHECK(mined >= 1);
+        CHECK(blockchain.validate_chain());
+    }
+    SUBCASE("the engine pool is reconfigured while mining") {
+        // the task holds the last reference to the pool it runs on once it is replaced
+        blockchain.set_difficulty(4);
+        blockchain.set_max_iterations(size_t{1} << 40);
+        std::thread reconfigure([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            ThreadPool::configure(2);
+        });
+        CHECK(mine_async(blockchain, "reconfigured").get());
+        reconfigure.join();
+        CHECK(blockchain.validate_chain());
+        ThreadPool::configure(0);
+        blockchain.set_difficulty(2);
+    }
+    SUBCASE("cancellation and timeouts stop the search") {
+        blockchain.set_difficulty(64); // never met
+        blockchain.set_max_iterations(size_t{1} << 40);
+        CancellationToken token;
+        token.cancel();
+        CHECK(!mine_async(blockchain, "cancelled", token).get());
+        const auto start{std::chrono::steady_clock::now()};
+        CHECK(!mine_async(blockchain, "timed out", CancellationToken::with_timeout(std::chrono::milliseconds(50))).get());
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    }
+}
@@ -0,0 +1,196 @@
+#ifndef ASYNC_HEADER_FILE
+#define ASYNC_HEADER_FILE
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "blockchain.hpp"
+#include "thread_pool.hpp"
+
+/* Task
+
+  Purpose: lazily started coroutine producing a T (or an exception), a task runs
+           when it is awaited (by another coroutine), waited for (get) or
+           started with a completion callback (start)
+*/
+template <typename T>
+struct Task {
+
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        auto get_return_object() -> Task { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+        auto final_suspend() noexcept {
+            // resume the awaiting coroutine (symmetric transfer)
+            struct Resume {
+                auto await_ready() noexcept -> bool { return false; }
+                auto await_suspend(std::coroutine_handle<promise_type> done) noexcept -> std::coroutine_handle<> {
+                    const auto next{done.promise().continuation};
+                    return next ? next : std::noop_coroutine();
+                }
+                auto await_resume() noexcept -> void {}
+            };
+            return Resume{};
+        }
+        auto return_value(T result) -> void { this->value.emplace(std::move(result)); }
+        auto unhandled_exception() -> void { this->error = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task(const Task&) = delete;
+    auto operator=(const Task&) -> Task& = delete;
+    ~Task() {
+        if (this->handle) this->handle.destroy();
+    }
+
+    // awaiting a task starts it, the awaiting coroutine resumes when it is done
+    auto operator co_await() && {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            auto await_ready() const noexcept -> bool { return false; }
+            auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<> {
+                this->handle.promise().continuation = awaiting;
+                return this->handle;
+            }
+            auto await_resume() -> T {
+                auto& promise{this->handle.promise()};
+                if (promise.error) std::rethrow_exception(promise.error);
+                return std::move(*promise.value);
+            }
+        };
+        return Awaiter{this->handle};
+    }
+
+    // run the task, done(result, nullptr) or done(nullptr, error) is called once it finishes
+    auto start(std::function<void(T*, std::exception_ptr)> done) && -> void {
+        drive(std::move(*this), std::move(done));
+    }
+
+    // run the task and block until it finishes (for synchronous callers)
+    auto get() && -> T {
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::optional<T> value;
+        std::exception_ptr error;
+        bool ready{false};
+        std::move(*this).start([&](T* result, std::exception_ptr e) {
+            std::lock_guard lock(mutex);
+            if (result) value.emplace(std::move(*result));
+            error = e;
+            ready = true;
+            finished.notify_all();
+        });
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&ready]() { return ready; });
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+        // a coroutine that owns nothing and frees itself when done
+        struct Detached {
+            struct promise_type {
+                auto get_return_object() noexcept -> Detached { return {}; }
+                auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+                auto final_suspend() noexcept -> std::suspend_never { return {}; }
+                auto return_void() noexcept -> void {}
+                auto unhandled_exception() noexcept -> void { std::terminate(); }
+            };
+        };
+
+        static auto drive(Task task, std::function<void(T*, std::exception_ptr)> done) -> Detached {
+            std::optional<T> value;
+            std::exception_ptr error;
+            try {
+                value.emplace(co_await std::move(task));
+            } catch (...) {
+                error = std::current_exception();
+            }
+            done(value ? &*value : nullptr, error);
+        }
+
+};
+
+/* CancellationToken
+
+  Purpose: cooperative cancellation shared between a caller and its tasks,
+           a token is cancelled explicitly or once its deadline has passed
+*/
+struct CancellationToken {
+
+    CancellationToken();
+
+    auto cancel() const -> void;
+    auto cancelled() const -> bool;
+
+    // a token that cancels itself after the given time
+    static auto with_timeout(const std::chrono::steady_clock::duration&) -> CancellationToken;
+
+    private:
+        struct State {
+            std::atomic<bool> cancelled{false};
+            std::optional<std::chrono::steady_clock::time_point> deadline;
+        };
+        std::shared_ptr<State> state;
+
+};
+
+// resume the awaiting coroutine on a pool worker
+inline auto schedule_on(ThreadPool& pool) {
+    struct Awaiter {
+        ThreadPool& pool;
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> h) -> void { this->pool.post([h]() { h.resume(); }); }
+        auto await_resume() const noexcept -> void {}
+    };
+    return Awaiter{pool};
+}
+
+// let the tasks queued on the pool run before resuming
+inline auto yield_to(ThreadPool& pool) {
+    struct Awaiter {
+        ThreadPool& pool;
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> h) -> void { this->pool.defer([h]() { h.resume(); }); }
+        auto await_resume() const noexcept -> void {}
+    };
+    return Awaiter{pool};
+}
+
+/* BlockView
+
+  Purpose: the fields of a block as returned by the asynchronous API,
+           the data is already decompressed (off the caller's thread)
+*/
+struct BlockView {
+    size_t index;
+    time_t timestamp;
+    size_t nonce;
+    std::string parent_hash;
+    std::string hash;
+    std::string data;
+};
+
+// mine a block on the engine thread pool, the search yields between slices of
+// nonces and stops (returning false) once the token is cancelled
+auto mine_async(Blockchain&, std::string, CancellationToken = {}) -> Task<bool>;
+
+// read a block on the engine thread pool (throws std::out_of_range past the end of the chain)
+auto get_block_async(const Blockchain&, size_t) -> Task<BlockView>;
+
+#endif // ASYNC_HEADER_FILE
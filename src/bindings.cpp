@@ -1,21 +1,186 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
+#include <pybind11/stl.h>
 
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+#include "async.hpp"
 #include "blockchain.hpp"
+#include "mempool.hpp"
+#include "node.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 
 namespace py = pybind11;
 
+namespace {
+
+    /* to_asyncio
+
+      Purpose: bridge an engine task to an asyncio future of the running event loop,
+               the result is set on the loop thread, cancelling the future cancels the task
+
+      Parameters: task, the engine task (started here)
+                  token, the task's cancellation token
+                  convert, converts the task result to a Python object (called with the GIL held)
+
+      Return: the asyncio future
+    */
+    template <typename T, typename Convert>
+    auto to_asyncio(Task<T> task, const CancellationToken& token, Convert convert) -> py::object {
+        auto loop{py::module_::import("asyncio").attr("get_running_loop")()};
+        auto future{loop.attr("create_future")()};
+        future.attr("add_done_callback")(py::cpp_function([token](py::object done) {
+            if (done.attr("cancelled")().cast<bool>()) token.cancel();
+        }));
+
+        // Python objects are only touched with the GIL held, the callback owns them
+        auto target{std::make_unique<std::pair<py::object, py::object>>(loop, future)};
+        std::move(task).start([target = target.release(), convert](T* result, std::exception_ptr error) {
+            py::gil_scoped_acquire gil;
+            const std::unique_ptr<std::pair<py::object, py::object>> owned{target};
+            const auto& [loop, future] = *owned;
+            py::object value;
+            py::object setter;
+            if (result) {
+                value = convert(*result);
+                setter = future.attr("set_result");
+            } else {
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::out_of_range& e) {
+                    value = py::module_::import("builtins").attr("IndexError")(e.what());
+                } catch (const std::exception& e) {
+                    value = py::module_::import("builtins").attr("RuntimeError")(e.what());
+                }
+                setter = future.attr("set_exception");
+            }
+            // the future may have been cancelled in the meantime
+            const auto settle{py::cpp_function([](py::object f, py::object set, py::object v) {
+                if (!f.attr("done")().cast<bool>()) set(v);
+            })};
+            try {
+                loop.attr("call_soon_threadsafe")(settle, future, setter, value);
+            } catch (const py::error_already_set&) {
+                // the event loop is closed, nobody is waiting for the result
+            }
+        });
+        return future;
+    }
+
+    // a NumPy array over the vector's memory (no copy), the array owns the vector
+    template <typename T>
+    auto to_numpy(std::vector<T>&& values, const std::vector<py::ssize_t>& shape) -> py::array_t<T> {
+        auto owned{std::make_unique<std::vector<T>>(std::move(values))};
+        const auto data{owned->data()};
+        py::capsule free(owned.get(), [](void* p) { delete static_cast<std::vector<T>*>(p); });
+        owned.release();
+        return py::array_t<T>(shape, data, free);
+    }
+
+    // a span opened and closed from Python (a context manager)
+    struct PythonSpan {
+        const char* name;
+        uint64_t start;
+    };
+
+    auto token_for(const std::optional<double>& timeout) -> CancellationToken {
+        if (!timeout) return {};
+        return CancellationToken::with_timeout(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(*timeout)));
+    }
+
+}
+
 PYBIND11_MODULE(backend, m) {
 
+    py::enum_<Durability>(m, "Durability")
+        .value("none", Durability::none)
+        .value("async", Durability::async)
+        .value("sync", Durability::sync);
+
+    py::enum_<Blockchain::Commitment>(m, "Commitment")
+        .value("payload", Blockchain::Commitment::payload)
+        .value("digest", Blockchain::Commitment::digest);
+
+    py::enum_<HashFunction>(m, "HashFunction")
+        .value("sha256", HashFunction::sha256)
+        .value("double_sha256", HashFunction::double_sha256)
+        .value("fnv1a", HashFunction::fnv1a);
+
     py::class_<Blockchain>(m, "Blockchain")
         .def(py::init())
-        .def("mine_block", &Blockchain::mine)
+        .def(py::init([](const Blockchain::Commitment &commitment, const HashFunction &hash) {
+                 return new Blockchain(time(nullptr), commitment, hash);
+             }),
+             py::arg("commitment") = Blockchain::Commitment::payload, py::arg("hash") = HashFunction::sha256)
+        .def("get_commitment", &Blockchain::get_commitment)
+        .def("get_hash_function", &Blockchain::get_hash_function)
+        .def("get_format", &Blockchain::get_format)
+        .def("mine_block",
+             [](Blockchain &blockchain, const std::string &data) {
+                 TRACE_SPAN("bindings Blockchain.mine_block");
+                 return blockchain.mine(data);
+             },
+             py::call_guard<py::gil_scoped_release>())
         .def("check_block_parent", &Blockchain::check_parent)
+        .def("check_block", &Blockchain::check_block)
+        .def("validate_chain", &Blockchain::validate_chain, py::call_guard<py::gil_scoped_release>())
+        // write-ahead log (restores the chain from an existing log)
+        .def("open_log",
+             [](Blockchain &blockchain, const std::string &path, const Durability &durability, const size_t &window_us) {
+                 return blockchain.open_log(path, durability, std::chrono::microseconds(window_us));
+             },
+             py::arg("path"), py::arg("durability") = Durability::sync, py::arg("window_us") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("sync_log",
+             [](const Blockchain &blockchain) {
+                 if (const auto log{blockchain.get_log()}) log->sync();
+             },
+             py::call_guard<py::gil_scoped_release>())
+        // payload pruning, old data is evicted to the cold store file (or dropped without one)
+        .def("set_pruning",
+             [](Blockchain &blockchain, const size_t &keep_depth, const size_t &budget, const std::string &cold_path) {
+                 return blockchain.set_pruning({keep_depth, budget, cold_path});
+             },
+             py::arg("keep_depth") = ~size_t{0}, py::arg("budget") = ~size_t{0}, py::arg("cold_path") = "")
+        .def("payload_stats",
+             [](const Blockchain &blockchain) {
+                 const auto stats{blockchain.get_payload_stats()};
+                 py::dict result;
+                 result["resident"] = stats.resident;
+                 result["cold"] = stats.cold;
+                 result["dropped"] = stats.dropped;
+                 result["resident_bytes"] = stats.resident_bytes;
+                 return result;
+             })
+        // awaitable versions (asyncio), they must be called from a running event loop
+        .def("mine_block_async",
+             [](Blockchain &blockchain, const std::string &data, const std::optional<double> &timeout) {
+                 const auto token{token_for(timeout)};
+                 return to_asyncio(mine_async(blockchain, data, token), token,
+                                   [](const bool &mined) { return py::bool_(mined); });
+             },
+             py::arg("data"), py::arg("timeout") = py::none(), py::keep_alive<0, 1>())
+        .def("get_block_async",
+             [](const Blockchain &blockchain, const size_t &index) {
+                 return to_asyncio(get_block_async(blockchain, index), CancellationToken{},
+                                   [](const BlockView &view) { return py::cast(view); });
+             },
+             py::keep_alive<0, 1>())
         .def("get_end_of_chain", &Blockchain::get_end_of_chain)
         .def("set_difficulty", &Blockchain::set_difficulty)
         .def("set_max_iterations", &Blockchain::set_max_iterations)
         .def("get_difficulty", &Blockchain::get_difficulty)
         .def("get_max_iterations", &Blockchain::get_max_iterations)
+        .def("train_codec", &Blockchain::train_codec)
+        .def("disable_compression",
+             [](Blockchain &blockchain) {
+                 blockchain.set_codec(nullptr);
+             })
         .def("get_last_block_index",
              [](const Blockchain &blockchain) {
                  return blockchain.get_end_of_chain().get_index();
@@ -28,10 +193,67 @@ PYBIND11_MODULE(backend, m) {
              [](const Blockchain &blockchain) {
                  return blockchain.get_end_of_chain().get_hash();
              })
-        .def("get_block_hash",
-             [](const Blockchain &blockchain, const size_t &block_id) {
-                 return blockchain.get_block(block_id).get_hash();
-             })
+        .def("get_block_hash", &Blockchain::get_block_hash)
+        // bulk export (NumPy arrays), one call for every block of the range
+        .def("export_columns",
+             [](const Blockchain &blockchain, const size_t &from, const size_t &count) {
+                 Blockchain::Columns columns;
+                 {
+                     py::gil_scoped_release release;
+                     columns = blockchain.export_columns(from, count);
+                 }
+                 const auto n{static_cast<py::ssize_t>(columns.index.size())};
+                 py::dict result;
+                 result["index"] = to_numpy(std::move(columns.index), {n});
+                 result["timestamp"] = to_numpy(std::move(columns.timestamp), {n});
+                 result["nonce"] = to_numpy(std::move(columns.nonce), {n});
+                 result["difficulty"] = to_numpy(std::move(columns.difficulty), {n});
+                 result["hash"] = to_numpy(std::move(columns.hash), {n, 32});
+                 return result;
+             },
+             py::arg("start") = 0, py::arg("count") = ~size_t{0})
+        .def("export_payloads",
+             [](const Blockchain &blockchain, const size_t &from, const size_t &count) {
+                 Blockchain::Payloads payloads;
+                 {
+                     py::gil_scoped_release release;
+                     payloads = blockchain.export_payloads(from, count);
+                 }
+                 const auto n{static_cast<py::ssize_t>(payloads.offsets.size())};
+                 const auto size{static_cast<py::ssize_t>(payloads.bytes.size())};
+                 return py::make_tuple(to_numpy(std::move(payloads.offsets), {n}), to_numpy(std::move(payloads.bytes), {size}));
+             },
+             py::arg("start") = 0, py::arg("count") = ~size_t{0})
+        // light clients, headers are BlockHeader::size bytes each, back to back
+        .def("export_headers",
+             [](const Blockchain &blockchain, const size_t &from, const size_t &count) {
+                 std::string encoded;
+                 {
+                     py::gil_scoped_release release;
+                     const auto headers{blockchain.export_headers(from, count)};
+                     encoded.reserve(headers.size() * BlockHeader::size);
+                     for (const auto &header : headers) header.encode(encoded);
+                 }
+                 return py::bytes(encoded);
+             },
+             py::arg("start") = 0, py::arg("count") = ~size_t{0})
+        .def_static("verify_headers",
+             [](const std::string &encoded, const size_t &difficulty, const std::optional<std::string> &previous,
+                const HashFunction &hash) {
+                 py::gil_scoped_release release;
+                 std::vector<BlockHeader> headers;
+                 headers.reserve(encoded.size() / BlockHeader::size);
+                 for (size_t pos{0}; pos < encoded.size();) headers.push_back(BlockHeader::decode(encoded, pos));
+                 std::optional<BlockHeader> last;
+                 if (previous) {
+                     size_t pos{0};
+                     last = BlockHeader::decode(*previous, pos);
+                 }
+                 const auto check{Blockchain::verify_headers(headers, difficulty, last, hash)};
+                 return std::make_pair(check.verified, check.work);
+             },
+             py::arg("headers"), py::arg("difficulty"), py::arg("previous") = py::none(),
+             py::arg("hash") = HashFunction::sha256)
         .def("get_last_block_parent",
              [](const Blockchain &blockchain) {
                  return blockchain.get_end_of_chain().get_parent_hash();
@@ -45,8 +267,90 @@ PYBIND11_MODULE(backend, m) {
                  return blockchain.get_end_of_chain().get_nonce();
              });
 
+    py::class_<BlockView>(m, "BlockView")
+        .def_readonly("index", &BlockView::index)
+        .def_readonly("timestamp", &BlockView::timestamp)
+        .def_readonly("nonce", &BlockView::nonce)
+        .def_readonly("parent_hash", &BlockView::parent_hash)
+        .def_readonly("hash", &BlockView::hash)
+        .def_readonly("data", &BlockView::data);
+
     py::class_<Block>(m, "Block")
         .def(py::init<const size_t, const size_t, const time_t, const std::string, const std::string, const std::string>())
-        .def("check_hash", &Block::check_hash);
+        .def("check_hash", &Block::check_hash<Sha256Hash>);
+
+    // the node keeps a reference to the chain, so the chain outlives the node
+    py::class_<Node>(m, "Node")
+        .def(py::init<Blockchain&>(), py::keep_alive<1, 2>())
+        .def("listen", &Node::listen)
+        .def("stop", &Node::stop)
+        .def("get_address", &Node::get_address)
+        .def("add_peer", &Node::add_peer)
+        .def("mine_block",
+             [](Node &node, const std::string &data) {
+                 TRACE_SPAN("bindings Node.mine_block");
+                 return node.mine(data);
+             },
+             py::call_guard<py::gil_scoped_release>())
+        .def("announce", &Node::announce, py::call_guard<py::gil_scoped_release>())
+        .def("sync_from", &Node::sync_from,
+             py::arg("address"), py::arg("connections") = 4,
+             py::call_guard<py::gil_scoped_release>());
+
+    py::class_<Mempool>(m, "Mempool")
+        .def(py::init<const size_t&>(), py::arg("memory_cap") = size_t{64} << 20)
+        .def("add", &Mempool::add, py::arg("record"), py::arg("priority") = 0)
+        .def("add_batch", &Mempool::add_batch, py::arg("records"), py::arg("priority") = 0)
+        .def("contains", &Mempool::contains)
+        .def("size", &Mempool::size)
+        .def("get_memory_usage", &Mempool::get_memory_usage)
+        .def("get_memory_cap", &Mempool::get_memory_cap);
+
+    // the assembler keeps references to the chain and the mempool
+    py::class_<BlockAssembler>(m, "BlockAssembler")
+        .def(py::init<Blockchain&, Mempool&, const size_t&>(),
+             py::arg("blockchain"), py::arg("mempool"), py::arg("max_block_bytes") = size_t{1} << 20,
+             py::keep_alive<1, 2>(), py::keep_alive<1, 3>())
+        .def("mine_next", &BlockAssembler::mine_next, py::call_guard<py::gil_scoped_release>())
+        .def_static("decode", &BlockAssembler::decode);
+
+    // engine-wide thread pool (mining, chain validation and batched hashing)
+    py::enum_<ThreadPool::Placement>(m, "Placement")
+        .value("none", ThreadPool::Placement::none)
+        .value("cores", ThreadPool::Placement::cores)
+        .value("numa", ThreadPool::Placement::numa);
+
+    m.def("configure_pool", &ThreadPool::configure,
+          py::arg("threads") = 0, py::arg("placement") = ThreadPool::Placement::none);
+
+    // trace spans (recorded in builds with ENABLE_TRACING), dumped as Chrome trace-event JSON
+    m.attr("tracing") = Trace::compiled;
+    m.def("trace_dump", &Trace::dump, py::call_guard<py::gil_scoped_release>());
+    m.def("trace_clear", &Trace::clear);
+    m.def("trace_recording", &Trace::set_recording);
+
+    py::class_<PythonSpan>(m, "TraceSpan")
+        .def(py::init([](const std::string &name) {
+            return PythonSpan{Trace::compiled ? Trace::intern(name) : "", 0};
+        }))
+        .def("__enter__", [](PythonSpan &span) -> PythonSpan& {
+            span.start = Trace::now();
+            return span;
+        }, py::return_value_policy::reference)
+        .def("__exit__", [](PythonSpan &span, py::args) {
+            if (Trace::compiled) Trace::record(span.name, span.start, Trace::now());
+            return false;
+        });
+
+    m.def("pool_stats", []() {
+        const auto stats{ThreadPool::engine()->get_stats()};
+        py::dict result;
+        result["threads"] = stats.threads;
+        result["queue_depth"] = stats.queue_depth;
+        result["max_queue_depth"] = stats.max_queue_depth;
+        result["executed"] = stats.executed;
+        result["steals"] = stats.steals;
+        return result;
+    });
 
 }
@@ -1,21 +1,56 @@
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
 #include "block.hpp"
-#include "sha256.hpp"
+#include "wire.hpp"
 
 Block::Block(const size_t& block_nonce, const size_t& id, const time_t& block_time, const std::string& parent, 
              const std::string& block_data, const std::string& block_hash) :
-   index(id), data(block_data), timestamp(block_time), parent_hash(parent), nonce(block_nonce), hash(block_hash) {
+   index(id), codec(nullptr), data(block_data), timestamp(block_time), parent_hash(parent), nonce(block_nonce), hash(block_hash),
+   store(nullptr), verified(false), residency(Residency::resident) {
 }
 
+Block::Block(const size_t& block_nonce, const size_t& id, const time_t& block_time, const std::string& parent, 
+             const std::string& block_data, const std::string& block_hash, const std::shared_ptr<const Codec>& block_codec) :
+   index(id), codec(block_codec), data(block_codec ? block_codec->compress(block_data) : block_data), 
+   timestamp(block_time), parent_hash(parent), nonce(block_nonce), hash(block_hash),
+   store(nullptr), verified(false), residency(Residency::resident) {
+}
+
+// the chain vector relocates blocks when it grows, moving them must not throw (or copy)
+static_assert(std::is_nothrow_move_constructible_v<Block>);
+
 auto Block::get_index() const -> size_t {
     return this->index;
 }
 
+// the data is only decompressed on request, blocks keep the compressed form
 auto Block::get_data() const -> std::string {
-    return this->data;
+    if (this->residency != Residency::resident) {
+        const auto stored{this->load()};
+        return (this->codec) ? this->codec->decompress(stored) : stored;
+    }
+    return (this->codec) ? this->codec->decompress(this->data) : this->data;
+}
+
+auto Block::get_stored_size() const -> size_t {
+    switch (this->residency) {
+        case Residency::cold: {
+            size_t pos{8};
+            return get_u32(this->data, pos);
+        }
+        case Residency::dropped:
+            return 0;
+        default:
+            return this->data.size();
+    }
+}
+
+auto Block::is_compressed() const -> bool {
+    return (this->codec) ? true : false;
 }
 
 auto Block::get_timestamp() const -> std::time_t {
@@ -34,11 +69,92 @@ auto Block::get_nonce() const -> size_t {
     return this->nonce;
 }
 
-// calculate the block fingerprint with SHA-256
+// calculate the block fingerprint with a hash policy,
+// the preimage always covers the raw (uncompressed) data (the payload
+// commitment, Blockchain::hash_block hashes blocks of digest committed chains)
+template <typename Hash>
 auto Block::check_hash() const -> std::string {
-    std::stringstream ss;
-    ss << this->nonce << this->index << this->timestamp << this->parent_hash << this->data;
-    return SHA256(ss.str()).compute_digest();
+    return Hash::digest(payload_preimage(this->nonce, this->index, this->timestamp, this->parent_hash, this->get_data()));
+}
+
+template auto Block::check_hash<Sha256Hash>() const -> std::string;
+template auto Block::check_hash<DoubleSha256Hash>() const -> std::string;
+template auto Block::check_hash<Fnv1aHash>() const -> std::string;
+
+auto Block::data_equals(const std::string& raw) const -> bool {
+    if (this->residency == Residency::dropped) return false;
+    if (this->residency == Residency::cold) return this->get_data() == raw;
+    return (this->codec) ? (this->codec->decompress(this->data) == raw) : (this->data == raw);
+}
+
+/* evict
+
+  Purpose: free the memory held by the block data, the header fields stay
+
+  Parameters: cold, the store to spill the data to (null to drop the data)
+
+  Note: a cold block keeps the location of its data (12 bytes, small enough
+        to be held inside the string without a heap allocation)
+
+  Side effects: the data is moved to the store (or discarded),
+                evicting a block that is not resident does nothing
+*/
+auto Block::evict(const std::shared_ptr<ColdStore>& cold) -> void {
+    if (this->residency != Residency::resident) return;
+    std::string location;
+    if (cold) {
+        const auto stored{cold->put(this->data)};
+        put_u64(location, stored.offset);
+        put_u32(location, stored.size);
+    }
+    this->data.swap(location); // the old data is freed with location
+    this->store = cold;
+    this->residency = (cold) ? Residency::cold : Residency::dropped;
+}
+
+auto Block::get_residency() const -> Residency {
+    return this->residency;
+}
+
+auto Block::load() const -> std::string {
+    if (this->residency == Residency::dropped) {
+        throw std::runtime_error("block: the data of block " + std::to_string(this->index) + " was pruned");
+    }
+    if (this->residency == Residency::resident) return this->data;
+    size_t pos{0};
+    const auto offset{get_u64(this->data, pos)};
+    const auto size{get_u32(this->data, pos)};
+    return this->store->get({offset, size});
+}
+
+auto Block::is_verified() const -> bool {
+    return this->verified;
+}
+
+auto Block::mark_verified() -> void {
+    this->verified = true;
+}
+
+auto Block::serialize() const -> std::string {
+    std::string out;
+    out.reserve(48 + this->parent_hash.size() + this->hash.size() + this->data.size());
+    put_u64(out, this->index);
+    put_u64(out, static_cast<uint64_t>(this->timestamp));
+    put_u64(out, this->nonce);
+    put_bytes(out, this->parent_hash);
+    put_bytes(out, this->hash);
+    put_bytes(out, this->get_data());
+    return out;
+}
+
+auto Block::deserialize(const std::string& in, size_t& pos) -> Block {
+    const auto block_index{get_u64(in, pos)};
+    const auto block_time{static_cast<time_t>(get_u64(in, pos))};
+    const auto block_nonce{get_u64(in, pos)};
+    const auto parent{get_bytes(in, pos)};
+    const auto block_hash{get_bytes(in, pos)};
+    const auto block_data{get_bytes(in, pos)};
+    return Block(block_nonce, block_index, block_time, parent, block_data, block_hash);
 }
 
 auto operator<<(std::ostream& os, const Block& block) -> std::ostream& {
@@ -2,35 +2,74 @@
 #define BLOCK_HEADER_FILE
 
 #include <ctime>
+#include <memory>
 #include <string>
 #include <sstream>
 
+#include "codec.hpp"
+#include "cold_store.hpp"
+#include "hash_policy.hpp"
+
 /* Block
   
   Purpose: data structue to store all necessary block information
 */
 struct Block {
+
+    // where the block data is kept (the header fields always stay in memory)
+    enum class Residency : uint8_t {
+        resident, // in memory
+        cold,     // evicted to a cold store, read back on request
+        dropped   // evicted and discarded
+    };
     
     Block(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&, const std::string&);
+    // store the block data compressed with the given codec (stored raw if the codec is null)
+    Block(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&, const std::string&,
+          const std::shared_ptr<const Codec>&);
     
     // getter functions
     auto get_index() const -> size_t;
-    auto get_data() const -> std::string;
+    auto get_data() const -> std::string; // decompresses the data (if compressed), throws std::runtime_error if it was dropped
+    auto get_stored_size() const -> size_t; // size of the data as stored in the block (or in the cold store), 0 once dropped
+    auto is_compressed() const -> bool;
     auto get_timestamp() const -> std::time_t;
     auto get_parent_hash() const -> std::string;
     auto get_hash() const -> std::string;
     auto get_nonce() const -> size_t;
+    // hash of the block fields with the payload commitment (instantiated for every hash policy)
+    template <typename Hash = Sha256Hash>
     auto check_hash() const -> std::string;
+    auto data_equals(const std::string&) const -> bool; // compare with raw data (decompresses only if needed, false once dropped)
+
+    // evict the data from memory to the store (the data is dropped if the store is null)
+    auto evict(const std::shared_ptr<ColdStore>&) -> void;
+    auto get_residency() const -> Residency;
+
+    // a verified block's hash has been checked against its own fields
+    auto is_verified() const -> bool;
+    auto mark_verified() -> void;
+    
+    // binary encoding of the block fields (with the raw data), deserialize
+    // advances the position and throws std::runtime_error on malformed input
+    auto serialize() const -> std::string;
+    static auto deserialize(const std::string&, size_t&) -> Block;
     
     friend auto operator<<(std::ostream&, const Block&) -> std::ostream&;
     
     private:
         const size_t index; // unique id for the block
-        const std::string data; // data stored in the block
+        const std::shared_ptr<const Codec> codec; // codec for the stored data (null when stored raw)
+        // the strings are not const so that blocks are moved (not copied) when the chain grows
+        std::string data; // data stored in the block (compressed when a codec is set), the location in the store once cold
         const std::time_t timestamp; // time stamp of block generation
-        const std::string parent_hash; // hash of the parent block in the blockchain
+        std::string parent_hash; // hash of the parent block in the blockchain
         const size_t nonce; // "number used once"
-        const std::string hash; // block signature
+        std::string hash; // block signature
+        std::shared_ptr<const ColdStore> store; // holds the data of a cold block
+        bool verified; // hash checked once (set on append or validation)
+        Residency residency;
+        auto load() const -> std::string; // the stored data (read back from the store if cold)
 };
 
 #endif // BLOCK_HEADER_FILE
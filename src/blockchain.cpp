@@ -1,29 +1,50 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+
+#include <unistd.h>
+
 #include "blockchain.hpp"
 #include "sha256.hpp"
+#include "sha256_fixed.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "wire.hpp"
+
+Blockchain::Blockchain() : Blockchain(time(nullptr)) {
+}
 
-Blockchain::Blockchain() : difficulty(0), sdifficulty(0), max_iterations(10000) {
-    this->genesis_block_generation();
+Blockchain::Blockchain(const time_t& genesis_timestamp, const Commitment& ncommitment, const HashFunction& nhash_function) :
+    commitment(ncommitment), hash_function(nhash_function), difficulty(0), sdifficulty(0), difficulty_pins(0), max_iterations(10000), codec(nullptr), log(nullptr), durability(Durability::sync),
+    pruning(std::nullopt), cold(nullptr), first_resident(1), resident_bytes(0) {
+    this->genesis_block_generation(genesis_timestamp);
 }
 
 /* genesis_block_generation
 
   Purpose: generate the first block in the chain (the genesis block)
 
-  Parameters: None
+  Parameters: timestamp, genesis block timestamp
 
   Return: None
 
+  Note: the data of the genesis block is "Genesis", followed by the chain-format
+        tag for chains of another format than the original one
+
   Side effects: genesis block is created and added to the chain
 */
-auto Blockchain::genesis_block_generation() -> void {
+auto Blockchain::genesis_block_generation(const time_t& timestamp) -> void {
     // initialize all block info
     const size_t index{0}; 
     const size_t nonce{0};  
-    const time_t timestamp{time(nullptr)};
     const std::string parent{NULL}; // genesis block has no parent, hence NULL
-    const std::string data{"Genesis"};
+    const auto format{this->get_format()};
+    const std::string data{(format == Blockchain::format_tag(Commitment::payload, HashFunction::sha256)) ? "Genesis" : "Genesis " + format};
     // genesis block has hash of 64 0s
-    const auto hash{"0000000000000000000000000000000000000000000000000000000000000000"};
+    const std::string hash{Blockchain::genesis_hash};
     // create the genesis block
     auto block{Block(nonce, index, timestamp, parent, data, hash)};
     // add the genesis block to the chain
@@ -37,33 +58,235 @@ auto Blockchain::genesis_block_generation() -> void {
 
   Parameters: block, the block to add
               proof_hash, the proof of work hash for the block to add
+              difficulty, the difficulty the proof was mined for
+              level, durability of the append (the log default if not given)
 
   Return: True if the block is valid (and is added)
           False if the block is not valid (and is not added)
 
-  Side effects: valid block is added to the chain
+  Side effects: valid block is added to the chain (and to the log, if any)
 */
-auto Blockchain::add_block(Block& block, const std::string& proof_hash) -> bool {
+auto Blockchain::add_block(Block& block, const std::string& proof_hash, const size_t& difficulty,
+                           const std::optional<Durability>& level) -> bool {
+    TRACE_SPAN("Blockchain::add_block");
   
-    auto last_hash{this->get_end_of_chain().get_hash()};
+    // check the proof (before locking, the block is not shared yet)
+    if (!(this->check_proof(block, proof_hash, difficulty))) return false;
+    block.mark_verified(); // the proof check hashed the block fields
+
+    std::unique_lock lock(this->mutex);
   
     // check to make sure the parent hash for the block is the same
-    // as the last block in the chain hash
-    if (last_hash != block.get_parent_hash()) return false;
+    // as the last block in the chain hash (another block may have been added while mining)
+    if (this->blockchain.back().get_hash() != block.get_parent_hash()) return false;
   
-    // check the proof
-    if (!(this->check_proof(block, proof_hash))) return false;
-    this->blockchain.push_back(block);
+    const auto [logged, sequence]{this->log_append(block, level)};
+    this->push_block(block);
   
-    this->sdifficulty = this->difficulty; // set the successful difficulty = the difficulty
+    this->sdifficulty = difficulty; // set the successful difficulty = the difficulty
+    lock.unlock();
+
+    // wait for the group commit without holding up other appends
+    if (logged) logged->wait(sequence);
   
     return true;
 }
 
+/* push_block
+
+  Purpose: append a checked block to the chain (the chain lock is held)
+
+  Parameters: block, the block
+
+  Side effects: the data of older blocks is evicted if the pruning limits are exceeded
+*/
+auto Blockchain::push_block(const Block& block) -> void {
+    this->blockchain.push_back(block);
+    if (!this->pruning) return;
+    this->resident_bytes += block.get_stored_size();
+    this->prune_payloads();
+}
+
+/* log_append
+
+  Purpose: log a block about to be appended (the chain lock is held, so the
+           log holds the blocks in chain order)
+
+  Parameters: block, the block
+              level, durability of the append (the log default if not given)
+
+  Return: the log and the sequence number to wait for once the lock is released
+          (a null log when there is nothing to wait for)
+*/
+auto Blockchain::log_append(const Block& block, const std::optional<Durability>& level)
+    -> std::pair<std::shared_ptr<WriteAheadLog>, uint64_t> {
+    if (!this->log) return {nullptr, 0};
+    const auto durability_level{level.value_or(this->durability)};
+    // a sync append is only requested here, it is waited for after unlocking
+    const auto sequence{this->log->append(block.serialize(), durability_level == Durability::sync ? Durability::async : durability_level)};
+    if (durability_level != Durability::sync) return {nullptr, 0};
+    return {this->log, sequence};
+}
+
+/* open_log
+
+  Purpose: make the chain durable with a write-ahead log, an empty (or new) log
+           gets every block of the chain, a log holding blocks replaces the chain
+           with the logged chain (crash recovery)
+
+  Parameters: path, the log file
+              level, durability of appends made without one
+              window, group commit window of the log
+
+  Return: the number of blocks restored from the log (0 for a new log)
+
+  Note: the restored blocks are checked against their own hashes and linked to
+        their parents, the proofs of work are not re-checked (they were checked
+        when the blocks were appended)
+
+  Side effects: throws std::runtime_error if a log is already open, the log
+                cannot be opened or does not hold a valid chain of the same
+                format (commitment and hash function), or an empty
+                log would have to be seeded with dropped payloads
+*/
+auto Blockchain::open_log(const std::string& path, const Durability& level, const std::chrono::microseconds& window) -> size_t {
+    std::unique_lock lock(this->mutex);
+    if (this->log) throw std::runtime_error("blockchain: a log is already open");
+    auto wal{std::make_shared<WriteAheadLog>(path, window)};
+
+    if (wal->get_records() == 0) {
+        const auto dropped{std::any_of(this->blockchain.begin(), this->blockchain.end(), [](const Block& block) {
+            return block.get_residency() == Block::Residency::dropped;
+        })};
+        if (dropped) throw std::runtime_error("blockchain: a chain with dropped payloads cannot start a log");
+        for (const auto& block : this->blockchain) wal->append(block.serialize(), Durability::none);
+        wal->sync();
+        this->log = wal;
+        this->durability = level;
+        return 0;
+    }
+
+    std::vector<Block> restored;
+    wal->replay([this, &restored](const std::string& record) {
+        size_t pos{0};
+        const auto block{Block::deserialize(record, pos)};
+        restored.emplace_back(block.get_nonce(), block.get_index(), block.get_timestamp(), block.get_parent_hash(),
+                              block.get_data(), block.get_hash(), this->codec);
+    });
+    // the genesis block records the chain format
+    if (!restored.empty() && restored[0].get_data() != this->blockchain[0].get_data()) {
+        throw std::runtime_error("blockchain: the log holds a chain of another format (genesis \"" + restored[0].get_data() + "\")");
+    }
+    for (size_t i{0}; i < restored.size(); ++i) {
+        const auto& block{restored[i]};
+        const auto valid{(i == 0) ? (block.get_index() == 0 && block.get_hash() == Blockchain::genesis_hash)
+                                   : (block.get_index() == i && block.get_parent_hash() == restored[i-1].get_hash() &&
+                                      this->hash_block(block) == block.get_hash())};
+        if (!valid) throw std::runtime_error("blockchain: the log does not hold a valid chain (block " + std::to_string(i) + ")");
+        if (i > 0) restored[i].mark_verified();
+    }
+    this->blockchain = std::move(restored);
+    this->log = wal;
+    this->durability = level;
+    if (this->pruning) {
+        this->count_payloads();
+        this->prune_payloads();
+    }
+    return this->blockchain.size();
+}
+
+auto Blockchain::get_log() const -> std::shared_ptr<WriteAheadLog> {
+    std::shared_lock lock(this->mutex);
+    return this->log;
+}
+
+/* set_pruning
+
+  Purpose: bound the memory held by block data, the headers of every block stay
+           in memory (enough to extend and link the chain), the data of old
+           blocks is evicted to a cold store (read back by get_data) or dropped
+
+  Parameters: limits, the depth and byte budget of the data kept in memory and
+                      the cold store file (evicted data is dropped if empty)
+
+  Return: the number of blocks evicted to meet the new limits
+
+  Note: the genesis block is never evicted, evictions are in chain order (so the
+        blocks with their data in memory are the newest ones), the limits are
+        applied on every append, a new cold store file is truncated (it only
+        holds copies of data the write-ahead log, if any, holds too) but a file
+        whose store is still live (e.g. another chain prunes to it) is shared
+
+  Side effects: throws std::runtime_error if the cold store cannot be opened
+*/
+auto Blockchain::set_pruning(const Pruning& limits) -> size_t {
+    std::unique_lock lock(this->mutex);
+    if (limits.cold_path.empty()) this->cold = nullptr;
+    else if (!this->cold || this->cold->get_path() != limits.cold_path) this->cold = ColdStore::open(limits.cold_path);
+    this->pruning = limits;
+    this->count_payloads();
+    return this->prune_payloads();
+}
+
+auto Blockchain::get_payload_stats() const -> PayloadStats {
+    PayloadStats stats{0, 0, 0, 0};
+    std::shared_lock lock(this->mutex);
+    for (const auto& block : this->blockchain) {
+        switch (block.get_residency()) {
+            case Block::Residency::resident:
+                ++stats.resident;
+                stats.resident_bytes += block.get_stored_size();
+                break;
+            case Block::Residency::cold:
+                ++stats.cold;
+                break;
+            case Block::Residency::dropped:
+                ++stats.dropped;
+                break;
+        }
+    }
+    return stats;
+}
+
+// find the oldest resident block and the size of the data in memory (lock held)
+auto Blockchain::count_payloads() -> void {
+    this->first_resident = 1;
+    while (this->first_resident < this->blockchain.size() &&
+           this->blockchain[this->first_resident].get_residency() != Block::Residency::resident) ++this->first_resident;
+    this->resident_bytes = 0;
+    for (auto i{this->first_resident}; i < this->blockchain.size(); ++i) this->resident_bytes += this->blockchain[i].get_stored_size();
+}
+
+// evict the data of the oldest resident blocks until the pruning limits are met (lock held)
+auto Blockchain::prune_payloads() -> size_t {
+    const auto& limits{*this->pruning};
+    const auto length{this->blockchain.size()};
+    size_t evicted{0};
+    while (this->first_resident < length &&
+           (length - this->first_resident > limits.keep_depth || this->resident_bytes > limits.budget)) {
+        auto& block{this->blockchain[this->first_resident]};
+        const auto size{block.get_stored_size()};
+        block.evict(this->cold);
+        this->resident_bytes -= size;
+        ++this->first_resident;
+        ++evicted;
+    }
+    return evicted;
+}
+
 auto Blockchain::set_difficulty(const size_t& ndifficult) -> void {
+    if (this->difficulty_pins > 0 && ndifficult != this->difficulty) {
+        throw std::runtime_error("blockchain: the difficulty is pinned to " + std::to_string(this->difficulty) +
+                                 " while the chain is shared with peers");
+    }
     this->difficulty = ndifficult;
 }
 
+auto Blockchain::pin_difficulty(const bool& pinned) -> void {
+    if (pinned) ++this->difficulty_pins;
+    else --this->difficulty_pins;
+}
+
 auto Blockchain::set_max_iterations(const size_t& nmax_iterations) -> void {
     this->max_iterations = nmax_iterations;
 }
@@ -76,24 +299,21 @@ auto Blockchain::get_max_iterations() const -> size_t {
     return this->max_iterations;
 }
 
-/* gen_solution_str
+/* meets_difficulty
 
-  Purpose: generate the string of leading '0's from the difficulty,
+  Purpose: check that a hash starts with (at least) difficulty '0's,
            used to check proofs of work
 
-  Parameters: None
+  Parameters: hash, the hash to check
+              difficulty, the number of leading '0's required
 
-  Return: the solution string of leading '0's
+  Return: true if the hash meets the difficulty,
+          false otherwise
 
   Side effects: none
 */
-auto Blockchain::gen_solution_str() const -> std::string {
-    char* solution0s = new char[this->difficulty];
-    std::memset(solution0s, '0', this->difficulty);
-    std::string solution_str;
-    solution_str.assign(solution0s, solution0s + this->difficulty);
-    delete[] solution0s; 
-    return solution_str;
+auto Blockchain::meets_difficulty(const std::string& hash, const size_t& difficulty) -> bool {
+    return (hash.size() >= difficulty) && (hash.find_first_not_of('0') >= difficulty);
 }
 
 /* check_proof
@@ -102,16 +322,16 @@ auto Blockchain::gen_solution_str() const -> std::string {
 
   Parameters: block, the block to check the proof of work against
               proof, the proof of work hash
+              difficulty, the required difficulty
 
   Return: true if the proof checks out,
           false otherwise
 
   Side effects: none
 */
-auto Blockchain::check_proof(const Block& block, const std::string& proof) const -> bool {
-    // initialize "solution string" (string of 0s matching the difficulty)  
-    return ((proof == Blockchain::calc_hash(block.get_nonce(), block.get_index(), block.get_timestamp(), block.get_parent_hash(), block.get_data())) && 
-            (proof.substr(0,this->difficulty) == gen_solution_str())) ? true : false;
+auto Blockchain::check_proof(const Block& block, const std::string& proof, const size_t& difficulty) const -> bool {
+    return ((proof == this->hash_block(block)) && 
+            Blockchain::meets_difficulty(proof, difficulty)) ? true : false;
 }
 
 /* proof_of_work
@@ -122,25 +342,56 @@ auto Blockchain::check_proof(const Block& block, const std::string& proof) const
               index, the block index,
               timestamp, block mining timestamp
               parent_hash, the block's parent hash,
-              data, teh data in the block
+              committed, what the hash covers (see commit)
+              difficulty, the required difficulty
 
   Return: the hash meeting the difficulty
 
-  Side effects: nonce is incremented once for each for loop cycle
+  Note: when the expected work is large the nonce range is searched in chunks on
+        the engine thread pool, chunks are claimed in increasing order and the
+        smallest nonce found wins, so the result is the same as a sequential search
+
+  Side effects: nonce is set to the nonce of the proof (max_iterations + 1 if none was found)
 */
 auto Blockchain::proof_of_work(size_t& nonce, const size_t& index, const time_t& timestamp, 
-                               const std::string& parent, const std::string& data) -> std::string {
-  
-    auto proof_hash{Blockchain::calc_hash(nonce, index, timestamp, parent, data)}; // initial hash based on nonce of 0
-    // initialize "solution string" (string of 0s matching the difficulty)
-    auto solution_str{gen_solution_str()};
+                               const std::string& parent, const std::string& committed, const size_t& difficulty) -> std::string {
+    TRACE_SPAN("Blockchain::proof_of_work");
+    return with_hash_policy(this->hash_function, [&](auto policy) {
+        return this->search_nonces<decltype(policy)>(nonce, index, timestamp, parent, committed, difficulty);
+    });
+}
+
+template <typename Hash>
+auto Blockchain::search_nonces(size_t& nonce, const size_t& index, const time_t& timestamp,
+                               const std::string& parent, const std::string& committed, const size_t& difficulty) -> std::string {
+    const size_t max_nonce{this->max_iterations};
+    constexpr size_t chunk{1024}; // nonces per task
+    const auto pool{ThreadPool::engine()};
+    // difficulty d takes 16^d hashes on average, short searches are not worth splitting
+    if (pool->size() > 1 && difficulty >= 3 && max_nonce - nonce >= 4 * chunk) {
+        std::atomic<size_t> best{max_nonce + 1};
+        const auto first{nonce};
+        pool->parallel_for(0, (max_nonce - first) / chunk + 1, 1, [&](size_t c, size_t) {
+            const auto start{first + c * chunk};
+            const auto stop{std::min(max_nonce + 1, start + chunk)};
+            for (auto n{start}; n < stop && n < best; ++n) {
+                if (!Blockchain::meets_difficulty(this->hash_with<Hash>(n, index, timestamp, parent, committed), difficulty)) continue;
+                for (auto current{best.load()}; n < current && !best.compare_exchange_weak(current, n);) {}
+                break;
+            }
+        });
+        nonce = best;
+        return this->hash_with<Hash>(std::min(nonce, max_nonce), index, timestamp, parent, committed);
+    }
+
+    auto proof_hash{this->hash_with<Hash>(nonce, index, timestamp, parent, committed)}; // initial hash based on nonce of 0
     for (;;) {
         // check to see if the hash meets the difficulty, if it does, break
-        if (proof_hash.substr(0,this->difficulty) == solution_str) break;
+        if (Blockchain::meets_difficulty(proof_hash, difficulty)) break;
         nonce++;
         // if the number of attempts exceeds the max number of iterations, break
-        if (nonce > this->max_iterations) break;
-        proof_hash = Blockchain::calc_hash(nonce, index, timestamp, parent, data);
+        if (nonce > max_nonce) break;
+        proof_hash = this->hash_with<Hash>(nonce, index, timestamp, parent, committed);
     } 
     return proof_hash;
 }
@@ -150,7 +401,9 @@ auto Blockchain::proof_of_work(size_t& nonce, const size_t& index, const time_t&
   Purpose: mine a new block by determining the proof of work and adding it to the
            block chain
 
-  Parameters: block, the block to be mined
+  Parameters: new_data, the data for the block to be mined
+              timestamp, the block timestamp (defaults to the current time)
+              level, durability of the append (the log default if not given)
 
   Return: true is mine is successful,
           false otherwise
@@ -158,30 +411,82 @@ auto Blockchain::proof_of_work(size_t& nonce, const size_t& index, const time_t&
   Side effects: the new block is added to the chain (if mine is successful)
 */
 auto Blockchain::mine(const std::string& new_data) -> bool {
-    // get the last block on the chain
-    auto last_block{this->get_end_of_chain()};
-  
-    // potential new block info with the next index and input data
-    const auto index{last_block.get_index()+1};
+    return this->mine(new_data, time(nullptr));
+}
+
+auto Blockchain::mine(const std::string& new_data, const time_t& timestamp, const std::optional<Durability>& level) -> bool {
+    TRACE_SPAN("Blockchain::mine");
+    size_t index;
+    std::string parent;
+    std::shared_ptr<const Codec> block_codec;
+    {
+        // potential new block info with the next index after the last block on the chain
+        std::shared_lock lock(this->mutex);
+        const auto& last_block{this->blockchain.back()};
+        index = last_block.get_index()+1;
+        parent = last_block.get_hash();
+        block_codec = this->codec;
+    }
     size_t nonce{0};
-    const time_t timestamp{time(nullptr)};
-    const auto parent{last_block.get_hash()};
+    const size_t block_difficulty{this->difficulty};
   
     // determine the proof of work for the new block
-    auto proof_hash{this->proof_of_work(nonce, index, timestamp, parent, new_data)};
+    auto proof_hash{this->proof_of_work(nonce, index, timestamp, parent, this->commit(new_data), block_difficulty)};
   
-    // add the block to the chain
-    auto new_block{Block(nonce, index, timestamp, parent, new_data, proof_hash)};
-    return (this->add_block(new_block, proof_hash)) ? true : false;
+    // add the block to the chain (the data is compressed if a codec is set)
+    auto new_block{Block(nonce, index, timestamp, parent, new_data, proof_hash, block_codec)};
+    return (this->add_block(new_block, proof_hash, block_difficulty, level)) ? true : false;
+}
+
+/* begin_mining, continue_mining, complete_mining
+
+  Purpose: mine a block in slices, begin_mining snapshots the tip, each
+           continue_mining call tries at most the given number of nonces
+           (returning true once a proof is found or max_iterations is exceeded),
+           complete_mining adds the block
+
+  Note: the slices are searched sequentially (the nonce found is the same as
+        with mine), the caller decides what runs between slices
+
+  Return: complete_mining returns true if the block was added,
+          false if no proof was found or the chain moved on while mining
+*/
+auto Blockchain::begin_mining(const std::string& new_data, const time_t& timestamp) const -> MiningJob {
+    std::shared_lock lock(this->mutex);
+    const auto& last_block{this->blockchain.back()};
+    return {last_block.get_index()+1, timestamp, last_block.get_hash(), new_data,
+            this->difficulty, 0, this->max_iterations, "", this->codec, this->commit(new_data)};
+}
+
+auto Blockchain::continue_mining(MiningJob& job, const size_t& nonces) const -> bool {
+    return with_hash_policy(this->hash_function, [&](auto policy) { return this->search_slice<decltype(policy)>(job, nonces); });
+}
+
+template <typename Hash>
+auto Blockchain::search_slice(MiningJob& job, const size_t& nonces) const -> bool {
+    for (size_t tried{0}; tried < nonces; ++tried) {
+        if (!job.proof.empty() || job.nonce > job.max_nonce) return true;
+        auto hash{this->hash_with<Hash>(job.nonce, job.index, job.timestamp, job.parent, job.committed)};
+        if (Blockchain::meets_difficulty(hash, job.difficulty)) job.proof = std::move(hash);
+        else job.nonce++;
+    }
+    return !job.proof.empty() || job.nonce > job.max_nonce;
+}
+
+auto Blockchain::complete_mining(const MiningJob& job, const std::optional<Durability>& level) -> bool {
+    if (job.proof.empty()) return false;
+    auto new_block{Block(job.nonce, job.index, job.timestamp, job.parent, job.data, job.proof, job.codec)};
+    return this->add_block(new_block, job.proof, job.difficulty, level);
 }
 
 auto Blockchain::get_end_of_chain() const -> Block {
+    std::shared_lock lock(this->mutex);
     return this->blockchain.back();
 }
 
 /* calc_hash
 
-  Purpose: to determine the block signature with SHA-256
+  Purpose: to determine the block signature with a hash policy (SHA-256 by default)
 
   Parameters: nonce, number used once
               index, the block index,
@@ -189,25 +494,233 @@ auto Blockchain::get_end_of_chain() const -> Block {
               parent_hash, the block's parent hash,
               data, teh data in the block
 
-  Return: the SHA-256 digest (signature) of the block data
+  Return: the digest (signature) of the block data
+
+  Note: the preimage always covers the raw data, never the compressed form,
+        so a block's hash does not depend on how its data is stored,
+        short preimages are hashed with the fixed-size (unrolled) kernels
 
   Side effects: None
 */
+template <typename Hash>
 auto Blockchain::calc_hash(const size_t& nonce, const size_t& index, const time_t& timestamp, const std::string& parent_hash, const std::string& data) -> std::string {
-    std::stringstream ss;
-    ss << nonce << index << timestamp << parent_hash << data;
-    return SHA256(ss.str()).compute_digest();
+    TRACE_SPAN("Blockchain::calc_hash");
+    return Hash::digest(payload_preimage(nonce, index, timestamp, parent_hash, data));
+}
+
+template auto Blockchain::calc_hash<Sha256Hash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+template auto Blockchain::calc_hash<DoubleSha256Hash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+template auto Blockchain::calc_hash<Fnv1aHash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+
+/* calc_header_hash
+
+  Purpose: to determine the signature of a block of a digest committed chain
+
+  Parameters: nonce, number used once
+              index, the block index,
+              timestamp, block mining timestamp
+              parent_hash, the block's parent hash,
+              payload_digest, SHA-256 of the data in the block (32 raw bytes)
+
+  Return: the digest of the block header preimage (BlockHeader::preimage)
+
+  Note: the preimage has a fixed size, so a proof of work costs the same for
+        any data size
+
+  Side effects: None
+*/
+template <typename Hash>
+auto Blockchain::calc_header_hash(const size_t& nonce, const size_t& index, const time_t& timestamp, const std::string& parent_hash,
+                                  const std::string& payload_digest) -> std::string {
+    TRACE_SPAN("Blockchain::calc_header_hash");
+    return Hash::digest(BlockHeader::preimage(index, timestamp, nonce, parent_hash, payload_digest));
+}
+
+template auto Blockchain::calc_header_hash<Sha256Hash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+template auto Blockchain::calc_header_hash<DoubleSha256Hash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+template auto Blockchain::calc_header_hash<Fnv1aHash>(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+
+/* commit, hash_with, hash_committed, hash_block
+
+  Purpose: hash blocks the way the chain commits their data, commit gives what
+           the hash covers (the data itself, or its raw SHA-256 digest),
+           hash_with hashes the fields with it and a hash policy, hash_committed
+           with the policy of the chain and hash_block the fields of a stored block
+*/
+auto Blockchain::commit(const std::string& data) const -> std::string {
+    if (this->commitment == Commitment::payload) return data;
+    std::string digest(32, '\0');
+    hash_to_bytes(SHA256Fixed::digest(data), reinterpret_cast<uint8_t*>(digest.data()));
+    return digest;
+}
+
+template <typename Hash>
+auto Blockchain::hash_with(const size_t& nonce, const size_t& index, const time_t& timestamp, const std::string& parent_hash,
+                           const std::string& committed) const -> std::string {
+    return (this->commitment == Commitment::digest) ? Blockchain::calc_header_hash<Hash>(nonce, index, timestamp, parent_hash, committed)
+                                                    : Blockchain::calc_hash<Hash>(nonce, index, timestamp, parent_hash, committed);
+}
+
+auto Blockchain::hash_committed(const size_t& nonce, const size_t& index, const time_t& timestamp, const std::string& parent_hash,
+                                const std::string& committed) const -> std::string {
+    return with_hash_policy(this->hash_function, [&](auto policy) {
+        return this->hash_with<decltype(policy)>(nonce, index, timestamp, parent_hash, committed);
+    });
+}
+
+auto Blockchain::hash_block(const Block& block) const -> std::string {
+    return this->hash_committed(block.get_nonce(), block.get_index(), block.get_timestamp(), block.get_parent_hash(),
+                                this->commit(block.get_data()));
+}
+
+auto Blockchain::get_commitment() const -> Commitment {
+    return this->commitment;
+}
+
+auto Blockchain::get_hash_function() const -> HashFunction {
+    return this->hash_function;
+}
+
+auto Blockchain::get_format() const -> std::string {
+    return Blockchain::format_tag(this->commitment, this->hash_function);
+}
+
+auto Blockchain::format_tag(const Commitment& commitment, const HashFunction& function) -> std::string {
+    return hash_function_name(function) + ((commitment == Commitment::digest) ? "/digest" : "/payload");
 }
 
 
 auto Blockchain::get_chain_length() const -> size_t {
+    std::shared_lock lock(this->mutex);
     return this->blockchain.size();
 }
 
 auto Blockchain::get_block(const size_t& i) const -> Block {
+    std::shared_lock lock(this->mutex);
     return this->blockchain[i];
 }
 
+auto Blockchain::get_block_hash(const size_t& i) const -> std::string {
+    std::shared_lock lock(this->mutex);
+    return this->blockchain[i].get_hash();
+}
+
+// copy (at most) count blocks starting at block from
+auto Blockchain::get_blocks(const size_t& from, const size_t& count) const -> std::vector<Block> {
+    std::shared_lock lock(this->mutex);
+    const auto end{std::min(this->blockchain.size(), from + count)};
+    if (from >= end) return {};
+    return std::vector<Block>(this->blockchain.begin() + from, this->blockchain.begin() + end);
+}
+
+/* export_columns
+
+  Purpose: copy the fields of a range of blocks into one array per field,
+           so that a caller (e.g. NumPy) gets every field of every block in
+           a single call instead of one call per field and block
+
+  Parameters: from, the first block
+              count, the number of blocks (clipped to the end of the chain)
+
+  Return: the columns (every column holds one entry per block, the hash
+          column 32 bytes per block)
+
+  Side effects: none (the chain is read under the shared lock)
+*/
+auto Blockchain::export_columns(const size_t& from, const size_t& count) const -> Columns {
+    Columns columns;
+    std::shared_lock lock(this->mutex);
+    const auto end{std::min(this->blockchain.size(), from + std::min(count, this->blockchain.size()))};
+    if (from >= end) return columns;
+    const auto n{end - from};
+    columns.index.resize(n);
+    columns.timestamp.resize(n);
+    columns.nonce.resize(n);
+    columns.difficulty.resize(n);
+    columns.hash.resize(32 * n);
+    for (size_t i{0}; i < n; ++i) {
+        const auto& block{this->blockchain[from + i]};
+        const auto hash{block.get_hash()};
+        columns.index[i] = block.get_index();
+        columns.timestamp[i] = static_cast<int64_t>(block.get_timestamp());
+        columns.nonce[i] = block.get_nonce();
+        columns.difficulty[i] = static_cast<uint8_t>(std::min(hash.find_first_not_of('0'), hash.size()));
+        hash_to_bytes(hash, columns.hash.data() + 32 * i);
+    }
+    return columns;
+}
+
+/* export_payloads
+
+  Purpose: copy the data of a range of blocks back to back into one buffer
+
+  Parameters: from, the first block
+              count, the number of blocks (clipped to the end of the chain)
+
+  Return: the payloads (offsets holds one entry per block plus the end offset)
+
+  Side effects: none (compressed payloads are decompressed on the engine thread pool),
+                throws std::runtime_error if the data of a block was dropped
+*/
+auto Blockchain::export_payloads(const size_t& from, const size_t& count) const -> Payloads {
+    Payloads payloads;
+    std::shared_lock lock(this->mutex);
+    const auto end{std::min(this->blockchain.size(), from + std::min(count, this->blockchain.size()))};
+    if (from >= end) return payloads;
+    const auto n{end - from};
+
+    std::vector<std::string> data(n);
+    ThreadPool::engine()->parallel_for(0, n, 1024, [this, &data, from](const size_t& first, const size_t& last) {
+        for (auto i{first}; i < last; ++i) data[i] = this->blockchain[from + i].get_data();
+    });
+
+    payloads.offsets.resize(n + 1);
+    uint64_t offset{0};
+    for (size_t i{0}; i < n; ++i) {
+        payloads.offsets[i] = offset;
+        offset += data[i].size();
+    }
+    payloads.offsets[n] = offset;
+    payloads.bytes.resize(offset);
+    for (size_t i{0}; i < n; ++i) std::memcpy(payloads.bytes.data() + payloads.offsets[i], data[i].data(), data[i].size());
+    return payloads;
+}
+
+/* export_headers
+
+  Purpose: the fixed-size headers of a range of blocks, enough for a light
+           client to check the chain without the block data (verify_headers)
+
+  Parameters: from, the first block
+              count, the number of blocks (clipped to the end of the chain)
+
+  Return: the headers, the payload digests are computed on the engine thread pool
+
+  Note: the proof of work of the headers of a legacy (payload committed) chain
+        can not be checked, its hashes cover the data itself
+
+  Side effects: none, throws std::runtime_error if the data of a block was dropped
+*/
+auto Blockchain::export_headers(const size_t& from, const size_t& count) const -> std::vector<BlockHeader> {
+    std::shared_lock lock(this->mutex);
+    const auto end{std::min(this->blockchain.size(), from + std::min(count, this->blockchain.size()))};
+    if (from >= end) return {};
+    std::vector<BlockHeader> headers(end - from);
+    ThreadPool::engine()->parallel_for(0, headers.size(), 1024, [this, &headers, from](const size_t& first, const size_t& last) {
+        for (auto i{first}; i < last; ++i) {
+            const auto& block{this->blockchain[from + i]};
+            auto& header{headers[i]};
+            header.index = block.get_index();
+            header.timestamp = static_cast<int64_t>(block.get_timestamp());
+            header.nonce = block.get_nonce();
+            hash_to_bytes(block.get_parent_hash(), header.parent.data());
+            hash_to_bytes(SHA256Fixed::digest(block.get_data()), header.payload_digest.data());
+            hash_to_bytes(block.get_hash(), header.hash.data());
+        }
+    });
+    return headers;
+}
+
 /* check_parent
 
   Purpose: to determine if the parent hash of a block to be mined matches the 
@@ -223,5 +736,591 @@ auto Blockchain::get_block(const size_t& i) const -> Block {
   Side effects: None
 */
 auto Blockchain::check_parent(const std::string& parent_hash) const -> bool {
-    return (parent_hash == this->get_end_of_chain().get_hash()) ? true : false;
+    std::shared_lock lock(this->mutex);
+    return (parent_hash == this->blockchain.back().get_hash()) ? true : false;
+}
+
+
+auto Blockchain::set_codec(const std::shared_ptr<const Codec>& ncodec) -> void {
+    std::unique_lock lock(this->mutex);
+    this->codec = ncodec;
+}
+
+auto Blockchain::get_codec() const -> std::shared_ptr<const Codec> {
+    std::shared_lock lock(this->mutex);
+    return this->codec;
+}
+
+/* train_codec
+
+  Purpose: train a payload dictionary from data sampled across the chain
+           and use it to compress the data of newly mined blocks
+
+  Parameters: sample_count, maximum number of blocks to sample (spread evenly over the chain)
+              dictionary_size, maximum size of the dictionary in bytes
+
+  Return: true if a dictionary was trained (and the codec set)
+          false if the chain holds no data to train on
+
+  Side effects: the chain codec is replaced
+*/
+auto Blockchain::train_codec(const size_t& sample_count, const size_t& dictionary_size) -> bool {
+    std::vector<std::string> samples;
+    {
+        std::shared_lock lock(this->mutex);
+        // the genesis block is not representative of the chain data
+        const auto available{this->blockchain.size() - 1};
+        if (available == 0 || sample_count == 0) return false;
+        const auto count{std::min(sample_count, available)};
+        samples.reserve(count);
+        for (size_t i{0}; i < count; ++i) {
+            const auto& block{this->blockchain[1 + i * available / count]};
+            if (block.get_residency() != Block::Residency::dropped) samples.push_back(block.get_data());
+        }
+    }
+    auto dictionary{DictionaryCodec::train(samples, dictionary_size)};
+    if (dictionary.empty()) return false;
+    this->set_codec(std::make_shared<const DictionaryCodec>(dictionary));
+    return true;
+}
+
+/* check_block
+
+  Purpose: to determine if the given block fields match a block on the chain
+           (i.e. hash to the stored block signature)
+
+  Parameters: nonce, number used once
+              index, the block index,
+              timestamp, block mining timestamp
+              parent_hash, the block's parent hash,
+              data, the data in the block
+
+  Return: true if the fields hash to the signature of the block at index
+          false otherwise (including an index past the end of the chain)
+
+  Note: a verified block's signature is known to be the hash of its own fields,
+        so fields equal to the stored ones match without hashing, only fields
+        that differ (or blocks not yet verified) are hashed
+
+  Side effects: the stored block is marked verified if the fields match it
+*/
+auto Blockchain::check_block(const size_t& nonce, const size_t& index, const time_t& timestamp, 
+                             const std::string& parent_hash, const std::string& data) -> bool {
+    bool same_fields;
+    std::string stored_hash;
+    {
+        std::shared_lock lock(this->mutex);
+        if (index >= this->blockchain.size()) return false;
+        const auto& stored{this->blockchain[index]};
+        same_fields = nonce == stored.get_nonce() && timestamp == stored.get_timestamp() &&
+                      parent_hash == stored.get_parent_hash() && stored.data_equals(data);
+        if (same_fields && stored.is_verified()) return true;
+        stored_hash = stored.get_hash();
+    }
+    const auto matches{this->hash_committed(nonce, index, timestamp, parent_hash, this->commit(data)) == stored_hash};
+    if (matches && same_fields) {
+        std::unique_lock lock(this->mutex);
+        this->blockchain[index].mark_verified();
+    }
+    return matches;
+}
+
+/* import_block
+
+  Purpose: append a block mined elsewhere (e.g. received from a peer) to the chain
+
+  Parameters: block, the block to append
+              level, durability of the append (the log default if not given)
+
+  Return: true if the block extends the chain and its proof of work is valid
+               for the chain difficulty (and it is added)
+          false otherwise
+
+  Note: the block does not record its difficulty, the sender must mine at the
+        difficulty of this chain (see pin_difficulty)
+
+  Side effects: the block is added to the chain (stored with the chain codec) and to the log (if any)
+*/
+auto Blockchain::import_block(const Block& block, const std::optional<Durability>& level) -> bool {
+    TRACE_SPAN("Blockchain::import_block");
+    // validate the proof before locking
+    if (!(this->check_proof(block, block.get_hash(), this->difficulty))) return false;
+    auto stored{Block(block.get_nonce(), block.get_index(), block.get_timestamp(), block.get_parent_hash(),
+                      block.get_data(), block.get_hash(), this->get_codec())};
+    stored.mark_verified();
+
+    std::unique_lock lock(this->mutex);
+    const auto& last_block{this->blockchain.back()};
+    if (block.get_index() != last_block.get_index()+1 || block.get_parent_hash() != last_block.get_hash()) return false;
+    const auto [logged, sequence]{this->log_append(stored, level)};
+    this->push_block(stored);
+    lock.unlock();
+
+    if (logged) logged->wait(sequence);
+    return true;
+}
+
+/* validate_chain
+
+  Purpose: check every block of the chain, its hash must be the hash of its fields
+           and its parent hash the hash of the previous block, blocks are checked
+           in parallel on the engine thread pool
+
+  Return: true if every block is valid,
+          false otherwise
+
+  Note: blocks whose data was dropped (pruning) are only checked against their
+        parent, cold blocks are read back from the cold store
+
+  Side effects: valid blocks are marked verified
+*/
+auto Blockchain::validate_chain() -> bool {
+    TRACE_SPAN("Blockchain::validate_chain");
+    std::vector<char> valid;
+    {
+        std::shared_lock lock(this->mutex);
+        const auto& chain{this->blockchain};
+        valid.assign(chain.size(), 0);
+        valid[0] = chain[0].get_hash() == Blockchain::genesis_hash;
+        ThreadPool::engine()->parallel_for(1, chain.size(), 256, [this, &chain, &valid](size_t first, size_t last) {
+            for (auto i{first}; i < last; ++i) {
+                const auto& block{chain[i]};
+                // a block without its data was verified before it was pruned
+                const auto dropped{block.get_residency() == Block::Residency::dropped};
+                valid[i] = block.get_parent_hash() == chain[i - 1].get_hash() &&
+                           (dropped ? block.is_verified() : this->hash_block(block) == block.get_hash());
+            }
+        });
+    }
+    // the chain only grows, so the indices still refer to the same blocks
+    std::unique_lock lock(this->mutex);
+    for (size_t i{1}; i < valid.size(); ++i) {
+        if (valid[i]) this->blockchain[i].mark_verified();
+    }
+    return std::all_of(valid.begin(), valid.end(), [](const char v) { return v != 0; });
+}
+
+/* verify_headers
+
+  Purpose: check a range of headers of a digest committed chain, every header
+           must follow its predecessor (index and parent hash) and hold a proof
+           of work, its hash must be the hash of its preimage and meet the
+           difficulty, the proofs are re-computed on the engine thread pool
+
+  Parameters: headers, the headers in chain order
+              difficulty, the minimum difficulty of a proof
+              previous, the verified header the range follows (none if the range
+                        starts at the genesis block, whose hash is 64 0s)
+              function, the hash function of the chain
+
+  Return: the number of leading headers that are valid (the headers after the
+          first invalid one are not checked) and the expected number of hashes
+          it took to mine them (16^d for a hash with d leading '0's)
+
+  Side effects: none
+*/
+auto Blockchain::verify_headers(const std::vector<BlockHeader>& headers, const size_t& difficulty,
+                                const std::optional<BlockHeader>& previous, const HashFunction& function) -> HeaderCheck {
+    TRACE_SPAN("Blockchain::verify_headers");
+    HeaderCheck check{0, 0.0};
+    std::vector<std::string> proofs(headers.size());
+    with_hash_policy(function, [&headers, &proofs](auto policy) {
+        ThreadPool::engine()->parallel_for(0, headers.size(), 64, [&headers, &proofs](size_t first, size_t last) {
+            for (auto i{first}; i < last; ++i) proofs[i] = decltype(policy)::digest(headers[i].preimage());
+        });
+    });
+
+    for (size_t i{0}; i < headers.size(); ++i) {
+        const auto& header{headers[i]};
+        const auto hash{bytes_to_hash(header.hash.data())};
+        bool valid;
+        if (i == 0 && !previous) {
+            valid = header.index == 0 && hash == Blockchain::genesis_hash && header.parent == std::array<uint8_t, 32>{};
+        } else {
+            const auto& parent{(i == 0) ? *previous : headers[i - 1]};
+            valid = header.index == parent.index + 1 && header.parent == parent.hash && proofs[i] == hash &&
+                    Blockchain::meets_difficulty(hash, difficulty);
+        }
+        if (!valid) break;
+        if (header.index > 0) check.work += std::pow(16.0, static_cast<double>(std::min(hash.find_first_not_of('0'), hash.size())));
+        ++check.verified;
+    }
+    return check;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Blockchain block checks") {
+    Blockchain blockchain(1700000000);
+    blockchain.set_difficulty(1);
+    REQUIRE(blockchain.mine("first", 1700000010));
+    REQUIRE(blockchain.mine("second", 1700000020));
+    const auto block{blockchain.get_block(2)};
+    SUBCASE("mined blocks are verified, the genesis block is not") {
+        CHECK(blockchain.get_block(1).is_verified());
+        CHECK(block.is_verified());
+        CHECK(!blockchain.get_block(0).is_verified());
+    }
+    SUBCASE("matching fields") {
+        CHECK(blockchain.check_block(block.get_nonce(), 2, block.get_timestamp(), block.get_parent_hash(), "second"));
+    }
+    SUBCASE("tampered fields") {
+        CHECK(!blockchain.check_block(block.get_nonce(), 2, block.get_timestamp(), block.get_parent_hash(), "Second"));
+        CHECK(!blockchain.check_block(block.get_nonce() + 1, 2, block.get_timestamp(), block.get_parent_hash(), "second"));
+        CHECK(!blockchain.check_block(block.get_nonce(), 2, block.get_timestamp() + 1, block.get_parent_hash(), "second"));
+        CHECK(!blockchain.check_block(block.get_nonce(), 1, block.get_timestamp(), block.get_parent_hash(), "second"));
+        CHECK(!blockchain.check_block(block.get_nonce(), 7, block.get_timestamp(), block.get_parent_hash(), "second"));
+    }
+    SUBCASE("genesis fields never match the genesis signature") {
+        const auto genesis{blockchain.get_block(0)};
+        CHECK(!blockchain.check_block(genesis.get_nonce(), 0, genesis.get_timestamp(), genesis.get_parent_hash(), "Genesis"));
+    }
+}
+
+TEST_CASE("Blockchain bulk export") {
+    Blockchain blockchain(1700000000);
+    blockchain.set_difficulty(1);
+    for (size_t i{1}; i <= 20; ++i) REQUIRE(blockchain.mine("block " + std::to_string(i), 1700000000 + 10 * i));
+
+    SUBCASE("columns hold the fields of every block") {
+        const auto columns{blockchain.export_columns(0, 100)};
+        REQUIRE(columns.index.size() == 21);
+        REQUIRE(columns.hash.size() == 21 * 32);
+        for (size_t i{0}; i < 21; ++i) {
+            const auto block{blockchain.get_block(i)};
+            CHECK(columns.index[i] == i);
+            CHECK(columns.timestamp[i] == block.get_timestamp());
+            CHECK(columns.nonce[i] == block.get_nonce());
+            CHECK(Blockchain::meets_difficulty(block.get_hash(), columns.difficulty[i]));
+            CHECK(!Blockchain::meets_difficulty(block.get_hash(), columns.difficulty[i] + 1u));
+            std::string hex;
+            for (size_t b{0}; b < 32; ++b) {
+                static constexpr char digits[]{"0123456789abcdef"};
+                hex += digits[columns.hash[32 * i + b] >> 4];
+                hex += digits[columns.hash[32 * i + b] & 0xF];
+            }
+            CHECK(hex == block.get_hash());
+        }
+        CHECK(columns.difficulty[0] == 64); // the genesis hash is all '0's
+    }
+    SUBCASE("ranges are clipped to the chain") {
+        const auto columns{blockchain.export_columns(18, 10)};
+        CHECK(columns.index == std::vector<uint64_t>{18, 19, 20});
+        CHECK(blockchain.export_columns(21, 5).index.empty());
+        CHECK(blockchain.export_columns(5, size_t(-1)).index.size() == 16);
+        CHECK(blockchain.export_payloads(30, 1).offsets.empty());
+    }
+    SUBCASE("payloads are exported back to back, compressed or not") {
+        std::vector<std::string> samples;
+        for (size_t i{0}; i < 50; ++i) samples.push_back("{\"payment\":" + std::to_string(i) + ",\"currency\":\"EUR\"}");
+        blockchain.set_codec(std::make_shared<const DictionaryCodec>(DictionaryCodec::train(samples, 256)));
+        for (size_t i{21}; i <= 25; ++i) REQUIRE(blockchain.mine(samples[i], 1700000000 + 10 * i));
+        const auto payloads{blockchain.export_payloads(1, 25)};
+        REQUIRE(payloads.offsets.size() == 26);
+        for (size_t i{0}; i < 25; ++i) {
+            const std::string data(payloads.bytes.begin() + payloads.offsets[i], payloads.bytes.begin() + payloads.offsets[i + 1]);
+            CHECK(data == blockchain.get_block(i + 1).get_data());
+        }
+        CHECK(payloads.offsets.back() == payloads.bytes.size());
+    }
+}
+
+TEST_CASE("Blockchain write-ahead log") {
+    const auto path{"/tmp/blockchain_chain_log_test_" + std::to_string(getpid())};
+
+    SUBCASE("the chain is restored from its log") {
+        std::filesystem::remove(path);
+        std::string tip;
+        {
+            Blockchain blockchain(1700000000);
+            CHECK(blockchain.open_log(path) == 0);
+            for (size_t i{1}; i <= 10; ++i) {
+                [[maybe_unused]] const auto level{(i % 2) ? Durability::none : Durability::sync};
+                REQUIRE(blockchain.mine("logged block " + std::to_string(i), 1700000000 + 10 * i, level));
+            }
+            const auto end{blockchain.get_end_of_chain()};
+            const Block next(0, 11, 1700000110, end.get_hash(), "imported", Blockchain::calc_hash(0, 11, 1700000110, end.get_hash(), "imported"));
+            REQUIRE(blockchain.import_block(next, Durability::async));
+            tip = blockchain.get_end_of_chain().get_hash();
+            CHECK(blockchain.get_log()->get_records() == 12);
+            CHECK_THROWS(blockchain.open_log(path));
+        }
+        Blockchain restored; // another genesis block, replaced by the logged one
+        CHECK(restored.open_log(path) == 12);
+        CHECK(restored.get_chain_length() == 12);
+        CHECK(restored.get_end_of_chain().get_hash() == tip);
+        CHECK(restored.get_block(5).get_data() == "logged block 5");
+        CHECK(restored.validate_chain());
+        REQUIRE(restored.mine("after recovery", 1700000200));
+        CHECK(restored.get_log()->get_records() == 13);
+    }
+    SUBCASE("a log holding another chain is rejected") {
+        std::filesystem::remove(path);
+        {
+            WriteAheadLog log(path);
+            Blockchain other(1700000000);
+            other.mine("block 1", 1700000010);
+            log.append(other.get_block(0).serialize(), Durability::none);
+            log.append(Block(0, 2, 1700000020, "no such parent", "block 2", "hash").serialize(), Durability::sync);
+        }
+        Blockchain blockchain;
+        CHECK_THROWS(blockchain.open_log(path));
+        CHECK(blockchain.get_chain_length() == 1);
+        CHECK(blockchain.get_log() == nullptr);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Blockchain payload pruning") {
+    const auto cold_path{"/tmp/blockchain_cold_test_" + std::to_string(getpid())};
+    const auto log_path{"/tmp/blockchain_pruned_log_test_" + std::to_string(getpid())};
+    const auto mine_blocks{[](Blockchain& blockchain) {
+        blockchain.set_difficulty(1);
+        for (size_t i{1}; i <= 20; ++i) REQUIRE(blockchain.mine("block " + std::to_string(i), 1700000000 + 10 * i));
+    }};
+
+    SUBCASE("payloads deeper than the kept depth are dropped") {
+        Blockchain blockchain(1700000000);
+        mine_blocks(blockchain);
+        CHECK(blockchain.set_pruning({5, size_t(-1), ""}) == 15);
+        auto stats{blockchain.get_payload_stats()};
+        CHECK(stats.resident == 6); // the genesis block and the last 5 blocks
+        CHECK(stats.dropped == 15);
+        CHECK(blockchain.get_block(0).get_data() == "Genesis");
+        CHECK(blockchain.get_block(16).get_data() == "block 16");
+        CHECK(blockchain.get_block(3).get_residency() == Block::Residency::dropped);
+        CHECK(blockchain.get_block(3).get_stored_size() == 0);
+        CHECK_THROWS(blockchain.get_block(3).get_data());
+        CHECK_THROWS(blockchain.export_payloads(0, 21));
+        // headers are enough to extend, link and check the chain
+        const auto block{blockchain.get_block(3)};
+        CHECK(blockchain.check_block(block.get_nonce(), 3, block.get_timestamp(), block.get_parent_hash(), "block 3"));
+        CHECK(!blockchain.check_block(block.get_nonce(), 3, block.get_timestamp(), block.get_parent_hash(), "block 4"));
+        REQUIRE(blockchain.mine("block 21", 1700000210));
+        blockchain.set_difficulty(0);
+        const auto end{blockchain.get_end_of_chain()};
+        const Block next(0, 22, 1700000220, end.get_hash(), "imported", Blockchain::calc_hash(0, 22, 1700000220, end.get_hash(), "imported"));
+        REQUIRE(blockchain.import_block(next));
+        CHECK(blockchain.validate_chain());
+        stats = blockchain.get_payload_stats();
+        CHECK(stats.resident == 6);
+        CHECK(stats.dropped == 17);
+        CHECK(stats.resident_bytes == std::string("Genesis").size() + 4 * std::string("block 20").size() + std::string("imported").size());
+        blockchain.train_codec(100, 64); // samples the blocks that still have their data
+        std::filesystem::remove(log_path);
+        CHECK_THROWS(blockchain.open_log(log_path));
+    }
+    SUBCASE("payloads beyond the budget are read back from the cold store") {
+        Blockchain blockchain(1700000000);
+        mine_blocks(blockchain);
+        const auto payloads{blockchain.export_payloads(0, 21)};
+        std::vector<std::string> samples;
+        for (size_t i{0}; i < 50; ++i) samples.push_back("{\"payment\":" + std::to_string(i) + ",\"currency\":\"EUR\"}");
+        blockchain.set_codec(std::make_shared<const DictionaryCodec>(DictionaryCodec::train(samples, 256)));
+        CHECK(blockchain.set_pruning({size_t(-1), 40, cold_path}) > 0);
+        for (size_t i{21}; i <= 40; ++i) REQUIRE(blockchain.mine(samples[i], 1700000000 + 10 * i));
+        [[maybe_unused]] const auto stats{blockchain.get_payload_stats()};
+        CHECK(stats.cold > 15);
+        CHECK(stats.dropped == 0);
+        CHECK(stats.resident_bytes <= 40 + std::string("Genesis").size());
+        CHECK(blockchain.get_block(5).get_residency() == Block::Residency::cold);
+        CHECK(blockchain.get_block(5).get_stored_size() == std::string("block 5").size());
+        CHECK(blockchain.get_block(40).get_residency() == Block::Residency::resident);
+        const auto exported{blockchain.export_payloads(0, 41)};
+        CHECK(std::equal(payloads.offsets.begin(), payloads.offsets.end(), exported.offsets.begin()));
+        for (size_t i{21}; i <= 40; ++i) {
+            const auto data{blockchain.get_block(i).get_data()};
+            CHECK(data == samples[i]);
+            const auto block{blockchain.get_block(i)};
+            CHECK(blockchain.check_block(block.get_nonce(), i, block.get_timestamp(), block.get_parent_hash(), samples[i]));
+        }
+        CHECK(blockchain.validate_chain());
+    }
+    SUBCASE("chains pruning to the same file share its store") {
+        // payloads large enough for the stores to write them out of their buffers
+        const auto payload{[](const size_t& i) { return std::to_string(i) + std::string(size_t{200} << 10, 'p'); }};
+        const auto mine_large{[&payload](Blockchain& blockchain) {
+            blockchain.set_difficulty(1);
+            for (size_t i{1}; i <= 10; ++i) REQUIRE(blockchain.mine(payload(i), 1700000000 + 10 * i));
+        }};
+        Blockchain first(1700000000);
+        mine_large(first);
+        CHECK(first.set_pruning({2, size_t(-1), cold_path}) == 8);
+        Blockchain second(1700000001);
+        mine_large(second);
+        CHECK(second.set_pruning({2, size_t(-1), cold_path}) == 8);
+        // switching away and back does not truncate the store the cold blocks read from
+        first.set_pruning({2, size_t(-1), ""});
+        first.set_pruning({2, size_t(-1), cold_path});
+        for (size_t i{1}; i <= 8; ++i) {
+            CHECK(first.get_block(i).get_data() == payload(i));
+            CHECK(second.get_block(i).get_data() == payload(i));
+        }
+        CHECK(first.validate_chain());
+        CHECK(second.validate_chain());
+    }
+    SUBCASE("a chain restored from its log is pruned again") {
+        std::filesystem::remove(log_path);
+        {
+            Blockchain logged(1700000000);
+            logged.set_pruning({3, size_t(-1), cold_path});
+            logged.open_log(log_path);
+            for (size_t i{1}; i <= 10; ++i) REQUIRE(logged.mine("block " + std::to_string(i), 1700000000 + 10 * i, Durability::none));
+            CHECK(logged.get_payload_stats().cold == 7);
+        }
+        Blockchain restored;
+        restored.set_pruning({3, size_t(-1), ""});
+        CHECK(restored.open_log(log_path) == 11);
+        CHECK(restored.get_payload_stats().dropped == 7);
+        CHECK(restored.get_block(10).get_data() == "block 10");
+        CHECK(restored.validate_chain());
+    }
+    std::filesystem::remove(cold_path);
+    std::filesystem::remove(log_path);
+}
+
+TEST_CASE("Blockchain light-client headers") {
+    const auto mine_blocks{[](Blockchain& blockchain, const size_t& count) {
+        blockchain.set_difficulty(1);
+        for (size_t i{1}; i <= count; ++i) REQUIRE(blockchain.mine("block " + std::to_string(i), 1700000000 + 10 * i));
+    }};
+
+    SUBCASE("digest committed blocks hash their header preimage") {
+        Blockchain blockchain(1700000000, Blockchain::Commitment::digest);
+        CHECK(blockchain.get_commitment() == Blockchain::Commitment::digest);
+        mine_blocks(blockchain, 3);
+        const auto block{blockchain.get_block(2)};
+        const auto headers{blockchain.export_headers(0, 10)};
+        REQUIRE(headers.size() == 4);
+        CHECK(block.get_hash() == SHA256Fixed::digest(headers[2].preimage()));
+        CHECK(block.get_hash() != block.check_hash());
+        CHECK(headers[2].check_payload("block 2"));
+        CHECK(blockchain.check_block(block.get_nonce(), 2, block.get_timestamp(), block.get_parent_hash(), "block 2"));
+        CHECK(!blockchain.check_block(block.get_nonce(), 2, block.get_timestamp(), block.get_parent_hash(), "block 3"));
+        CHECK(blockchain.validate_chain());
+        // a chain only accepts blocks committed the way it commits its own
+        Blockchain legacy(1700000000);
+        CHECK(!legacy.import_block(blockchain.get_block(1)));
+    }
+    SUBCASE("a header chain is verified without the block data") {
+        Blockchain blockchain(1700000000, Blockchain::Commitment::digest);
+        mine_blocks(blockchain, 20);
+        auto headers{blockchain.export_headers(0, 21)};
+        [[maybe_unused]] auto check{Blockchain::verify_headers(headers, 1)};
+        CHECK(check.verified == 21);
+        CHECK(check.work >= 20 * 16.0);
+        // a later range continues from the last verified header
+        const std::vector<BlockHeader> tail(headers.begin() + 11, headers.end());
+        CHECK(Blockchain::verify_headers(tail, 1, headers[10]).verified == 10);
+        CHECK(Blockchain::verify_headers(tail, 1).verified == 0);
+        CHECK(Blockchain::verify_headers(headers, 64).verified == 1);
+        // a tampered header stops the verification
+        headers[7].timestamp += 1;
+        CHECK(Blockchain::verify_headers(headers, 1).verified == 7);
+        headers[7].timestamp -= 1;
+        headers[12].payload_digest[0] ^= 1;
+        CHECK(Blockchain::verify_headers(headers, 1).verified == 12);
+        headers[12].payload_digest[0] ^= 1;
+        std::swap(headers[15], headers[16]);
+        CHECK(Blockchain::verify_headers(headers, 1).verified == 15);
+    }
+    SUBCASE("the headers of a legacy chain link but hold no checkable proof") {
+        Blockchain blockchain(1700000000);
+        mine_blocks(blockchain, 3);
+        const auto headers{blockchain.export_headers(0, 4)};
+        CHECK(headers[1].check_payload("block 1"));
+        CHECK(headers[2].parent == headers[1].hash);
+        CHECK(Blockchain::verify_headers(headers, 1).verified == 1);
+    }
+}
+
+TEST_CASE("Blockchain hash policies") {
+    const auto log_path{std::filesystem::temp_directory_path() / ("blockchain_policy_test_" + std::to_string(getpid()))};
+    std::filesystem::remove(log_path);
+
+    SUBCASE("every policy mines, checks and validates its blocks") {
+        for (const auto function : {HashFunction::sha256, HashFunction::double_sha256, HashFunction::fnv1a}) {
+            Blockchain blockchain(1700000000, Blockchain::Commitment::payload, function);
+            CHECK(blockchain.get_hash_function() == function);
+            blockchain.set_difficulty(2);
+            blockchain.set_max_iterations(100000);
+            REQUIRE(blockchain.mine("first", 1700000010));
+            const auto mine_in_slices{[&]() {
+                auto job{blockchain.begin_mining("second", 1700000020)};
+                while (!blockchain.continue_mining(job, 100)) {}
+                return blockchain.complete_mining(job);
+            }};
+            REQUIRE(mine_in_slices());
+            const auto block{blockchain.get_block(1)};
+            const auto expected{with_hash_policy(function, [&block](auto policy) {
+                return Blockchain::calc_hash<decltype(policy)>(block.get_nonce(), 1, block.get_timestamp(), block.get_parent_hash(), "first");
+            })};
+            CHECK(block.get_hash() == expected);
+            CHECK(Blockchain::meets_difficulty(block.get_hash(), 2));
+            CHECK(blockchain.check_block(block.get_nonce(), 1, block.get_timestamp(), block.get_parent_hash(), "first"));
+            CHECK(blockchain.validate_chain());
+        }
+    }
+    SUBCASE("the chain format is tagged in the genesis block") {
+        CHECK(Blockchain(1700000000).get_format() == "sha256/payload");
+        CHECK(Blockchain(1700000000).get_block(0).get_data() == "Genesis");
+        Blockchain blockchain(1700000000, Blockchain::Commitment::digest, HashFunction::double_sha256);
+        CHECK(blockchain.get_format() == "double-sha256/digest");
+        CHECK(blockchain.get_block(0).get_data() == "Genesis double-sha256/digest");
+        REQUIRE(blockchain.mine("block 1", 1700000010));
+        const auto headers{blockchain.export_headers(0, 2)};
+        CHECK(Blockchain::verify_headers(headers, 0, std::nullopt, HashFunction::double_sha256).verified == 2);
+        CHECK(Blockchain::verify_headers(headers, 0).verified == 1);
+    }
+    SUBCASE("chains only accept blocks and logs of their own format") {
+        Blockchain fnv(1700000000, Blockchain::Commitment::payload, HashFunction::fnv1a);
+        REQUIRE(fnv.mine("block 1", 1700000010));
+        CHECK(fnv.get_block(1).check_hash<Fnv1aHash>() == fnv.get_block(1).get_hash());
+        CHECK(fnv.get_block(1).check_hash() != fnv.get_block(1).get_hash());
+        Blockchain sha(1700000000);
+        CHECK(!sha.import_block(fnv.get_block(1)));
+        CHECK(fnv.open_log(log_path) == 0);
+        Blockchain restored(1700000000, Blockchain::Commitment::payload, HashFunction::fnv1a);
+        CHECK(restored.open_log(log_path) == 2);
+        CHECK(restored.validate_chain());
+        Blockchain other;
+        CHECK_THROWS(other.open_log(log_path));
+    }
+    std::filesystem::remove(log_path);
+}
+
+TEST_CASE("Blockchain trace spans") {
+    Trace::clear();
+    Blockchain blockchain(1700000000);
+    blockchain.set_difficulty(1);
+    REQUIRE(blockchain.mine("traced", 1700000010));
+    const auto trace{Trace::dump()};
+    // without ENABLE_TRACING the spans are compiled out
+    for ([[maybe_unused]] const auto name : {"Blockchain::mine", "Blockchain::proof_of_work", "Blockchain::calc_hash", "Blockchain::add_block"}) {
+        CHECK((trace.find("\"name\":\"" + std::string{name} + "\"") != std::string::npos) == Trace::compiled);
+    }
+    Trace::clear();
+}
+
+TEST_CASE("Blockchain work on the engine thread pool") {
+    // the nonce search is split into chunks on the pool, the smallest nonce still wins
+    std::vector<std::string> hashes;
+    for (const size_t threads : {1, 4}) {
+        ThreadPool::configure(threads);
+        Blockchain blockchain(1700000000);
+        blockchain.set_difficulty(3);
+        blockchain.set_max_iterations(1000000);
+        REQUIRE(blockchain.mine("parallel nonce search", 1700000010));
+        hashes.push_back(blockchain.get_end_of_chain().get_hash());
+        blockchain.set_max_iterations(100);
+        CHECK(!blockchain.mine("not enough iterations", 1700000020));
+
+        blockchain.set_difficulty(0);
+        for (size_t i{0}; i < 600; ++i) blockchain.mine("block " + std::to_string(i), 1700000030 + i);
+        CHECK(blockchain.validate_chain());
+    }
+    CHECK(hashes[0] == hashes[1]);
+    CHECK(Blockchain::meets_difficulty(hashes[0], 3));
+    ThreadPool::configure(0);
 }
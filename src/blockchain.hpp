@@ -1,40 +1,190 @@
 #ifndef BLOCKCHAIN_HEADER_FILE
 #define BLOCKCHAIN_HEADER_FILE
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
 #include "block.hpp"
+#include "hash_policy.hpp"
+#include "header.hpp"
+#include "wal.hpp"
 
+/* Blockchain
+
+  Purpose: chain of blocks and the mining engine, safe to share between threads
+           (readers share a lock, appends are exclusive, proofs of work are
+           computed without holding the lock)
+*/
 struct Blockchain {
 
+    // what the hash of a block covers
+    enum class Commitment {
+        payload, // the block data itself (the original chain format)
+        digest   // a BlockHeader preimage holding the SHA-256 of the data, so that headers can be
+                 // checked without the data (and a proof of work costs the same for any data size)
+    };
+
     Blockchain();
+    // genesis block with a fixed timestamp (for reproducible chains), the commitment and
+    // the hash function of the proof of work are fixed for the life of the chain
+    explicit Blockchain(const time_t&, const Commitment& = Commitment::payload, const HashFunction& = HashFunction::sha256);
 
     auto get_end_of_chain() const -> Block;
+    // blocks do not record the difficulty they were mined for, imports are checked against
+    // the chain difficulty, so peers must share one fixed difficulty: while the difficulty
+    // is pinned (a Node is attached) set_difficulty throws if it would change it
     auto set_difficulty(const size_t&) -> void;
+    auto pin_difficulty(const bool&) -> void; // pins nest (every pin is released once)
     auto set_max_iterations(const size_t&) -> void;
     auto get_difficulty() const -> size_t;
     auto get_max_iterations() const -> size_t;
     auto mine(const std::string&) -> bool;
+    auto mine(const std::string&, const time_t&, const std::optional<Durability>& = std::nullopt) -> bool; // mine with a fixed timestamp
+    auto get_commitment() const -> Commitment;
+    auto get_hash_function() const -> HashFunction;
+    // chain-format tag ("<hash function>/<commitment>", e.g. "sha256/payload"), chains of
+    // another format than "sha256/payload" record it in the data of their genesis block
+    auto get_format() const -> std::string;
+    static auto format_tag(const Commitment&, const HashFunction&) -> std::string;
     auto get_chain_length() const -> size_t;
     auto get_block(const size_t&) const -> Block;
+    auto get_block_hash(const size_t&) const -> std::string;
+    auto get_blocks(const size_t&, const size_t&) const -> std::vector<Block>; // copy a range of blocks
+
+    // the fields of a range of blocks, one array per field (for bulk export)
+    struct Columns {
+        std::vector<uint64_t> index;
+        std::vector<int64_t> timestamp;
+        std::vector<uint64_t> nonce;
+        std::vector<uint8_t> difficulty; // difficulty met by the hash (its leading '0's)
+        std::vector<uint8_t> hash;       // 32 raw bytes per block
+    };
+    // the (decompressed) data of a range of blocks, block i is bytes[offsets[i], offsets[i + 1])
+    struct Payloads {
+        std::vector<uint64_t> offsets;
+        std::vector<uint8_t> bytes;
+    };
+    auto export_columns(const size_t&, const size_t&) const -> Columns;   // (at most) count blocks starting at from
+    auto export_payloads(const size_t&, const size_t&) const -> Payloads;
+    // fixed-size headers of a range of blocks (for light clients)
+    auto export_headers(const size_t&, const size_t&) const -> std::vector<BlockHeader>;
     auto check_parent(const std::string&) const -> bool;
+    auto check_block(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> bool;
+    // append a block mined elsewhere (after validating it)
+    auto import_block(const Block&, const std::optional<Durability>& = std::nullopt) -> bool;
+    auto validate_chain() -> bool; // re-hash and check the linkage of every block (on the engine thread pool)
+
+    // a proof of work searched in slices (e.g. by a coroutine that yields between slices)
+    struct MiningJob {
+        size_t index;
+        time_t timestamp;
+        std::string parent;
+        std::string data;
+        size_t difficulty;
+        size_t nonce;
+        size_t max_nonce;
+        std::string proof; // empty until a proof is found
+        std::shared_ptr<const Codec> codec;
+        std::string committed; // what the hash covers (the data or its digest)
+    };
+    auto begin_mining(const std::string&, const time_t&) const -> MiningJob;
+    auto continue_mining(MiningJob&, const size_t&) const -> bool; // try (at most) n nonces, true once the search is over
+    auto complete_mining(const MiningJob&, const std::optional<Durability>& = std::nullopt) -> bool; // add the mined block (if a proof was found)
+
+    // log appended blocks to a write-ahead log, an empty log gets the current chain,
+    // otherwise the chain is restored from the log (returns the number of blocks restored)
+    // appends made without a durability use the given default
+    auto open_log(const std::string&, const Durability& = Durability::sync,
+                  const std::chrono::microseconds& window = std::chrono::microseconds{0}) -> size_t;
+    auto get_log() const -> std::shared_ptr<WriteAheadLog>; // null without a log
+
+    // payload pruning, every header stays in memory, the data of blocks deeper than
+    // keep_depth (or beyond budget bytes of stored data in memory) is evicted, oldest
+    // first, to a cold store at cold_path (or dropped if cold_path is empty)
+    struct Pruning {
+        size_t keep_depth;
+        size_t budget;
+        std::string cold_path;
+    };
+    struct PayloadStats {
+        size_t resident; // blocks per residency
+        size_t cold;
+        size_t dropped;
+        size_t resident_bytes; // stored size of the data in memory
+    };
+    auto set_pruning(const Pruning&) -> size_t; // returns the number of blocks evicted at once
+    auto get_payload_stats() const -> PayloadStats;
 
-    // calculate the block fingerprint with SHA-256
+    // payload compression for newly mined blocks (existing blocks keep their codec)
+    auto set_codec(const std::shared_ptr<const Codec>&) -> void;
+    auto get_codec() const -> std::shared_ptr<const Codec>;
+    auto train_codec(const size_t&, const size_t&) -> bool;
+
+    // hash of the genesis block (64 '0's)
+    static constexpr char genesis_hash[]{"0000000000000000000000000000000000000000000000000000000000000000"};
+
+    // calculate the block fingerprint (SHA-256 unless another hash policy is given)
+    template <typename Hash = Sha256Hash>
     static auto calc_hash(const size_t &, const size_t &, const time_t &, const std::string &, const std::string &) -> std::string;
 
+    // calculate the fingerprint of a digest committed block (the payload digest is 32 raw bytes)
+    template <typename Hash = Sha256Hash>
+    static auto calc_header_hash(const size_t &, const size_t &, const time_t &, const std::string &, const std::string &) -> std::string;
+
+    // check that a hash starts with (at least) the given number of '0's
+    static auto meets_difficulty(const std::string&, const size_t&) -> bool;
+
+    // check a range of headers of a digest committed chain (linkage and proof of work),
+    // starting at the genesis block or at a previously verified header
+    struct HeaderCheck {
+        size_t verified; // leading headers that are valid
+        double work;     // expected number of hashes behind the verified headers
+    };
+    static auto verify_headers(const std::vector<BlockHeader>&, const size_t&,
+                               const std::optional<BlockHeader>& = std::nullopt,
+                               const HashFunction& = HashFunction::sha256) -> HeaderCheck;
+
     private:
+        const Commitment commitment;
+        const HashFunction hash_function;
+        mutable std::shared_mutex mutex; // guards the chain and the codec
         std::vector<Block> blockchain;
         // difficulty is the preferred chain difficulty, sdifficulty is the difficulty set for the last successful mine
-        size_t difficulty, sdifficulty;
-        size_t max_iterations;
-        auto genesis_block_generation() -> void;
-        auto add_block(Block&, const std::string&) -> bool;
-        auto check_proof(const Block&, const std::string&) const -> bool;
-        auto proof_of_work(size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
-        auto gen_solution_str() const -> std::string;
+        std::atomic<size_t> difficulty, sdifficulty;
+        std::atomic<size_t> difficulty_pins;
+        std::atomic<size_t> max_iterations;
+        std::shared_ptr<const Codec> codec; // null when block data is stored raw
+        std::shared_ptr<WriteAheadLog> log; // null when blocks are not logged
+        Durability durability; // default durability of logged appends
+        std::optional<Pruning> pruning; // unset when every payload stays in memory
+        std::shared_ptr<ColdStore> cold; // null when evicted payloads are dropped
+        size_t first_resident; // oldest block with its data in memory (evictions are in chain order)
+        size_t resident_bytes; // stored size of the data in memory (tracked while pruning)
+        auto genesis_block_generation(const time_t&) -> void;
+        auto push_block(const Block&) -> void;
+        auto count_payloads() -> void;
+        auto prune_payloads() -> size_t;
+        auto add_block(Block&, const std::string&, const size_t&, const std::optional<Durability>&) -> bool;
+        auto log_append(const Block&, const std::optional<Durability>&) -> std::pair<std::shared_ptr<WriteAheadLog>, uint64_t>;
+        auto check_proof(const Block&, const std::string&, const size_t&) const -> bool;
+        auto commit(const std::string&) const -> std::string; // what the hash of a block with the given data covers
+        auto hash_committed(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) const -> std::string;
+        auto hash_block(const Block&) const -> std::string;
+        auto proof_of_work(size_t&, const size_t&, const time_t&, const std::string&, const std::string&, const size_t&) -> std::string;
+        // the hashing hot loops, instantiated for every hash policy
+        template <typename Hash>
+        auto hash_with(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) const -> std::string;
+        template <typename Hash>
+        auto search_nonces(size_t&, const size_t&, const time_t&, const std::string&, const std::string&, const size_t&) -> std::string;
+        template <typename Hash>
+        auto search_slice(MiningJob&, const size_t&) const -> bool;
 
 };
 
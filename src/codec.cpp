@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "codec.hpp"
+
+namespace {
+
+    // tags for the first byte of a stored payload
+    constexpr unsigned char stored_raw{0x00};
+    constexpr unsigned char stored_lz{0x01};
+
+    auto write_varint(std::string& out, size_t value) -> void {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    auto read_varint(const std::string& in, size_t& pos) -> size_t {
+        size_t value{0};
+        for (size_t shift{0}; shift < 64; shift += 7) {
+            if (pos >= in.size()) throw std::runtime_error("codec: truncated varint");
+            const auto byte{static_cast<unsigned char>(in[pos++])};
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("codec: malformed varint");
+    }
+
+    auto load8(const unsigned char* p) -> uint64_t {
+        uint64_t gram{0};
+        for (size_t i{0}; i < 8; ++i) gram = (gram << 8) | p[i];
+        return gram;
+    }
+
+}
+
+DictionaryCodec::DictionaryCodec(const std::string& dict) :
+    dictionary(dict), dict_head(size_t{1} << hash_bits, -1), dict_chain(dict.size(), -1) {
+
+    // prime the match finder with every position in the dictionary, so that
+    // compress only has to index the payload itself
+    const auto window{reinterpret_cast<const unsigned char*>(this->dictionary.data())};
+    for (size_t p{0}; p + min_match <= this->dictionary.size(); ++p) {
+        const auto h{hash4(window + p)};
+        this->dict_chain[p] = this->dict_head[h];
+        this->dict_head[h] = static_cast<int32_t>(p);
+    }
+}
+
+auto DictionaryCodec::hash4(const unsigned char* p) -> uint32_t {
+    const uint32_t v{static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                     static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24};
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+auto DictionaryCodec::name() const -> std::string {
+    return "dict-lz";
+}
+
+auto DictionaryCodec::get_dictionary() const -> const std::string& {
+    return this->dictionary;
+}
+
+/* compress
+
+  Purpose: compress a payload as a sequence of (literal run, match) tokens,
+           matches may reference the dictionary or earlier payload bytes
+
+  Parameters: raw, the payload to compress
+
+  Return: the stored representation (tagged, falls back to raw storage when
+          compression does not pay off)
+
+  Side effects: None
+*/
+auto DictionaryCodec::compress(const std::string& raw) const -> std::string {
+
+    const auto D{this->dictionary.size()};
+    const auto W{D + raw.size()};
+    const std::string buffer{this->dictionary + raw};
+    const auto window{reinterpret_cast<const unsigned char*>(buffer.data())};
+
+    auto head{this->dict_head};
+    auto chain{this->dict_chain};
+    chain.resize(W, -1);
+
+    auto insert = [&](const size_t& p) {
+        if (p + min_match > W) return;
+        const auto h{hash4(window + p)};
+        chain[p] = head[h];
+        head[h] = static_cast<int32_t>(p);
+    };
+
+    std::string out;
+    out.reserve(raw.size() / 2 + 16);
+    out.push_back(static_cast<char>(stored_lz));
+
+    size_t literal_start{D};
+    size_t i{D};
+    while (i < W) {
+        size_t best_len{0}, best_pos{0};
+        if (i + min_match <= W) {
+            auto candidate{head[hash4(window + i)]};
+            for (size_t depth{0}; candidate >= 0 && depth < max_chain; ++depth) {
+                const auto c{static_cast<size_t>(candidate)};
+                size_t len{0};
+                while (len < max_match && i + len < W && window[c + len] == window[i + len]) ++len;
+                if (len > best_len) { best_len = len; best_pos = c; }
+                candidate = chain[c];
+            }
+        }
+        if (best_len < min_match) {
+            insert(i++);
+            continue;
+        }
+        write_varint(out, i - literal_start);
+        out.append(buffer, literal_start, i - literal_start);
+        write_varint(out, best_len);
+        write_varint(out, i - best_pos);
+        for (const auto end{i + best_len}; i < end; ++i) insert(i);
+        literal_start = i;
+    }
+    // the stream always ends with a (possibly empty) literal run
+    write_varint(out, W - literal_start);
+    out.append(buffer, literal_start, W - literal_start);
+
+    if (out.size() > raw.size()) {
+        out.clear();
+        out.push_back(static_cast<char>(stored_raw));
+        out += raw;
+    }
+    return out;
+}
+
+/* decompress
+
+  Purpose: recover the raw payload from its stored representation
+
+  Parameters: stored, the output of compress (with the same dictionary)
+
+  Return: the raw payload
+
+  Side effects: throws std::runtime_error if the stored payload is malformed
+*/
+auto DictionaryCodec::decompress(const std::string& stored) const -> std::string {
+
+    if (stored.empty()) throw std::runtime_error("codec: empty payload");
+    const auto tag{static_cast<unsigned char>(stored[0])};
+    if (tag == stored_raw) return stored.substr(1);
+    if (tag != stored_lz) throw std::runtime_error("codec: unknown payload tag");
+
+    const auto D{this->dictionary.size()};
+    std::string out;
+    out.reserve(2 * stored.size());
+    size_t pos{1};
+    for (;;) {
+        const auto literals{read_varint(stored, pos)};
+        if (literals > stored.size() - pos) throw std::runtime_error("codec: truncated literals");
+        out.append(stored, pos, literals);
+        pos += literals;
+        if (pos == stored.size()) break;
+
+        const auto len{read_varint(stored, pos)};
+        const auto offset{read_varint(stored, pos)};
+        if (len > max_match) throw std::runtime_error("codec: match too long");
+        if (offset == 0 || offset > D + out.size()) throw std::runtime_error("codec: match out of range");
+        auto from{D + out.size() - offset};
+        auto remaining{len};
+        if (from < D) { // the match starts in the dictionary
+            const auto n{std::min(remaining, D - from)};
+            out.append(this->dictionary, from, n);
+            remaining -= n;
+            from += n;
+        }
+        if (remaining == 0) continue;
+        // copy forwards so that overlapping matches repeat the pattern
+        const auto start{out.size()};
+        out.resize(start + remaining);
+        auto dst{&out[start]};
+        const auto src{&out[from - D]};
+        for (size_t k{0}; k < remaining; ++k) dst[k] = src[k];
+    }
+    return out;
+}
+
+/* train
+
+  Purpose: build a dictionary from sample payloads (a simplified COVER algorithm),
+           segments covering the 8-byte grams shared by the most samples are
+           selected greedily until the dictionary is full
+
+  Parameters: samples, representative payloads
+              dictionary_size, maximum size of the dictionary in bytes
+
+  Return: the dictionary, the most valuable segments are placed last (closest
+          to the payload, so matches into them have the shortest offsets)
+
+  Side effects: None
+*/
+auto DictionaryCodec::train(const std::vector<std::string>& samples, const size_t& dictionary_size) -> std::string {
+
+    constexpr size_t d{8};  // gram length
+    constexpr size_t k{32}; // segment length
+
+    if (dictionary_size == 0) return {};
+
+    // number of samples containing each gram
+    std::unordered_map<uint64_t, uint32_t> frequency;
+    for (const auto& sample : samples) {
+        std::unordered_set<uint64_t> seen;
+        const auto bytes{reinterpret_cast<const unsigned char*>(sample.data())};
+        for (size_t p{0}; p + d <= sample.size(); ++p) {
+            const auto gram{load8(bytes + p)};
+            if (seen.insert(gram).second) ++frequency[gram];
+        }
+    }
+
+    struct Segment { uint64_t score; size_t sample; size_t pos; size_t len; };
+    auto score = [&](const Segment& segment) {
+        const auto bytes{reinterpret_cast<const unsigned char*>(samples[segment.sample].data()) + segment.pos};
+        std::unordered_set<uint64_t> counted;
+        uint64_t total{0};
+        for (size_t p{0}; p + d <= segment.len; ++p) {
+            const auto gram{load8(bytes + p)};
+            if (!counted.insert(gram).second) continue;
+            const auto f{frequency[gram]};
+            if (f > 1) total += f;
+        }
+        return total;
+    };
+    auto lower = [](const Segment& a, const Segment& b) {
+        if (a.score != b.score) return a.score < b.score;
+        if (a.sample != b.sample) return a.sample > b.sample;
+        return a.pos > b.pos;
+    };
+    std::priority_queue<Segment, std::vector<Segment>, decltype(lower)> candidates(lower);
+    for (size_t s{0}; s < samples.size(); ++s) {
+        const auto n{samples[s].size()};
+        if (n < d) continue;
+        for (size_t p{0}; p == 0 || p + k <= n; p += k / 2) {
+            Segment segment{0, s, p, std::min(k, n - p)};
+            segment.score = score(segment);
+            if (segment.score > 0) candidates.push(segment);
+        }
+    }
+
+    // greedy selection with lazy re-scoring (selected grams no longer count)
+    std::vector<std::string> selected;
+    size_t total{0};
+    while (!candidates.empty() && total < dictionary_size) {
+        auto segment{candidates.top()};
+        candidates.pop();
+        const auto current{score(segment)};
+        if (current == 0) continue;
+        if (current < segment.score) {
+            segment.score = current;
+            candidates.push(segment);
+            continue;
+        }
+        const auto& sample{samples[segment.sample]};
+        const auto len{std::min(segment.len, dictionary_size - total)};
+        selected.push_back(sample.substr(segment.pos, len));
+        total += len;
+        const auto bytes{reinterpret_cast<const unsigned char*>(sample.data()) + segment.pos};
+        for (size_t p{0}; p + d <= segment.len; ++p) frequency[load8(bytes + p)] = 0;
+    }
+
+    std::string dict;
+    dict.reserve(total);
+    for (auto it{selected.rbegin()}; it != selected.rend(); ++it) dict += *it;
+    return dict;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Dictionary codec") {
+    auto record = [](const size_t& i) {
+        return "{\"from\":\"acct-" + std::to_string(1000 + i % 37) + "\",\"to\":\"acct-" +
+               std::to_string(2000 + i % 53) + "\",\"amount\":" + std::to_string(i * 7 % 1000) +
+               ",\"currency\":\"USD\",\"memo\":\"invoice " + std::to_string(i) + "\"}";
+    };
+    SUBCASE("round trip without a dictionary") {
+        DictionaryCodec codec("");
+        for ([[maybe_unused]] const auto& raw : {std::string{}, std::string{"a"}, std::string{"abcabcabcabcabcabc"},
+                                      std::string(1000, 'x'), std::string(200000, 'y'), record(1) + record(2) + record(3)}) {
+            CHECK(codec.decompress(codec.compress(raw)) == raw);
+        }
+    }
+    SUBCASE("trained dictionary improves compression of small records") {
+        std::vector<std::string> samples;
+        for (size_t i{0}; i < 200; ++i) samples.push_back(record(i));
+        const auto dict{DictionaryCodec::train(samples, 1024)};
+        CHECK(!dict.empty());
+        CHECK(dict.size() <= 1024);
+        DictionaryCodec plain(""), trained(dict);
+        size_t raw_bytes{0}, plain_bytes{0}, trained_bytes{0};
+        for (size_t i{500}; i < 600; ++i) {
+            const auto raw{record(i)};
+            const auto stored{trained.compress(raw)};
+            CHECK(trained.decompress(stored) == raw);
+            raw_bytes += raw.size();
+            plain_bytes += plain.compress(raw).size();
+            trained_bytes += stored.size();
+        }
+        CHECK(trained_bytes < plain_bytes);
+        CHECK(2 * trained_bytes < raw_bytes);
+    }
+    SUBCASE("incompressible payloads are stored raw") {
+        DictionaryCodec codec("");
+        std::string raw;
+        for (size_t i{0}; i < 256; ++i) raw.push_back(static_cast<char>((i * 151 + 7) % 256));
+        const auto stored{codec.compress(raw)};
+        CHECK(stored.size() == raw.size() + 1);
+        CHECK(codec.decompress(stored) == raw);
+    }
+    SUBCASE("malformed payloads are rejected") {
+        DictionaryCodec codec("");
+        CHECK_THROWS(codec.decompress(""));
+        CHECK_THROWS(codec.decompress(std::string{"\x07"}));
+        CHECK_THROWS(codec.decompress(std::string{"\x01\x05" "ab"}));
+        CHECK_THROWS(codec.decompress(std::string{"\x01\x01" "a" "\x04\x09"}));
+        // a match may not expand to more than max_match bytes
+        CHECK_THROWS(codec.decompress(std::string{"\x01\x01" "a" "\xff\xff\xff\xff\x0f" "\x01"}));
+    }
+}
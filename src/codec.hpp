@@ -0,0 +1,63 @@
+#ifndef CODEC_HEADER_FILE
+#define CODEC_HEADER_FILE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "unit_test.hpp"
+
+/* Codec
+
+  Purpose: pluggable interface for compressing block payloads,
+           implementations must be stateless (blocks share a codec)
+*/
+struct Codec {
+
+    virtual ~Codec() = default;
+
+    // compress the raw payload into its stored representation
+    virtual auto compress(const std::string&) const -> std::string = 0;
+
+    // recover the raw payload from its stored representation
+    virtual auto decompress(const std::string&) const -> std::string = 0;
+
+    // short name of the codec (used for reporting)
+    virtual auto name() const -> std::string = 0;
+
+};
+
+/* DictionaryCodec
+
+  Purpose: LZ77 style codec whose match window is primed with a dictionary,
+           so that short, repetitive payloads (e.g. JSON records) compress well
+           on their own
+*/
+struct DictionaryCodec : Codec {
+
+    DictionaryCodec(const std::string&);
+
+    auto compress(const std::string&) const -> std::string override;
+    auto decompress(const std::string&) const -> std::string override;
+    auto name() const -> std::string override;
+
+    auto get_dictionary() const -> const std::string&;
+
+    // build a dictionary of (at most) the given size from sample payloads
+    static auto train(const std::vector<std::string>&, const size_t&) -> std::string;
+
+    private:
+        const std::string dictionary; // history prepended to every payload
+        std::vector<int32_t> dict_head; // match finder table primed with the dictionary
+        std::vector<int32_t> dict_chain; // match finder chain links within the dictionary
+
+        static constexpr size_t hash_bits{12};
+        static constexpr size_t min_match{4};
+        static constexpr size_t max_match{size_t{1} << 16}; // bounds what one match token may expand to
+        static constexpr size_t max_chain{16};
+
+        static inline auto hash4(const unsigned char*) -> uint32_t;
+
+};
+
+#endif // CODEC_HEADER_FILE
@@ -0,0 +1,197 @@
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cold_store.hpp"
+
+namespace {
+
+    auto system_error(const std::string& what) -> std::runtime_error {
+        return std::runtime_error("cold store: " + what + ": " + std::strerror(errno));
+    }
+
+    // stores opened by ColdStore::open, by normalized absolute path
+    std::mutex registry_mutex;
+    std::unordered_map<std::string, std::weak_ptr<ColdStore>> registry;
+
+}
+
+ColdStore::ColdStore(const std::string& npath, const size_t& buffer_size) :
+    path(npath), capacity(buffer_size), fd(-1), written(0) {
+    this->fd = ::open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (this->fd < 0) throw system_error("open " + this->path);
+}
+
+ColdStore::~ColdStore() {
+    close(this->fd);
+}
+
+/* open
+
+  Purpose: open a store that can be shared, while a store opened for the same
+           file is alive it is returned instead of truncating the file under it
+
+  Parameters: path, the store file
+
+  Return: the store
+
+  Side effects: throws std::runtime_error if the file cannot be opened
+*/
+auto ColdStore::open(const std::string& path) -> std::shared_ptr<ColdStore> {
+    const auto key{std::filesystem::absolute(path).lexically_normal().string()};
+    std::lock_guard lock(registry_mutex);
+    for (auto it{registry.begin()}; it != registry.end();) {
+        it = (it->second.expired()) ? registry.erase(it) : std::next(it);
+    }
+    if (auto store{registry[key].lock()}) return store;
+    auto store{std::make_shared<ColdStore>(path)};
+    registry[key] = store;
+    return store;
+}
+
+/* put
+
+  Purpose: store a payload
+
+  Parameters: payload, the payload (less than 4 GiB)
+
+  Return: the location of the payload
+
+  Side effects: the buffer is written to the file once it holds capacity bytes,
+                throws std::runtime_error if the write fails
+*/
+auto ColdStore::put(const std::string& payload) -> Location {
+    if (payload.size() > UINT32_MAX) throw std::runtime_error("cold store: payload too large");
+    std::lock_guard lock(this->mutex);
+    const Location location{this->written + this->buffer.size(), static_cast<uint32_t>(payload.size())};
+    this->buffer += payload;
+    if (this->buffer.size() >= this->capacity) this->flush();
+    return location;
+}
+
+auto ColdStore::flush() -> void {
+    size_t done{0};
+    while (done < this->buffer.size()) {
+        const auto n{pwrite(this->fd, this->buffer.data() + done, this->buffer.size() - done,
+                            static_cast<off_t>(this->written + done))};
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw system_error("write " + this->path);
+        done += static_cast<size_t>(n);
+    }
+    this->written += this->buffer.size();
+    this->buffer.clear();
+}
+
+/* get
+
+  Purpose: read a payload back
+
+  Parameters: location, where put stored the payload
+
+  Return: the payload
+
+  Note: written payloads are read without holding the lock (the written
+        part of the file never changes), buffered ones are copied under it
+
+  Side effects: throws std::runtime_error if the location is past the end of
+                the store or the read fails
+*/
+auto ColdStore::get(const Location& location) const -> std::string {
+    std::string payload(location.size, '\0');
+    const auto end{location.offset + location.size};
+    {
+        std::lock_guard lock(this->mutex);
+        if (end > this->written + this->buffer.size()) throw std::runtime_error("cold store: no payload at " + std::to_string(location.offset));
+        if (location.offset >= this->written) {
+            this->buffer.copy(payload.data(), location.size, location.offset - this->written);
+            return payload;
+        }
+        // the buffer is written as a whole, so a payload is either buffered or written
+    }
+    size_t done{0};
+    while (done < payload.size()) {
+        const auto n{pread(this->fd, payload.data() + done, payload.size() - done, static_cast<off_t>(location.offset + done))};
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw system_error("read " + this->path);
+        done += static_cast<size_t>(n);
+    }
+    return payload;
+}
+
+auto ColdStore::get_path() const -> const std::string& {
+    return this->path;
+}
+
+auto ColdStore::get_size() const -> uint64_t {
+    std::lock_guard lock(this->mutex);
+    return this->written + this->buffer.size();
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Cold payload store") {
+    const auto path{"/tmp/blockchain_cold_store_test_" + std::to_string(getpid())};
+
+    SUBCASE("payloads are read back from the buffer and from the file") {
+        ColdStore store(path, 64);
+        std::vector<std::string> payloads;
+        std::vector<ColdStore::Location> locations;
+        for (size_t i{0}; i < 40; ++i) {
+            payloads.push_back(std::string(i % 23, static_cast<char>('a' + i % 26)) + std::to_string(i));
+            locations.push_back(store.put(payloads.back()));
+            // the newest payload is still buffered, the oldest ones are on disk
+            CHECK(store.get(locations.back()) == payloads.back());
+            CHECK(store.get(locations.front()) == payloads.front());
+        }
+        for (size_t i{0}; i < payloads.size(); ++i) CHECK(store.get(locations[i]) == payloads[i]);
+        CHECK(std::filesystem::file_size(path) > 0);
+        CHECK(store.get({store.get_size(), 0}).empty());
+        CHECK_THROWS(store.get({store.get_size(), 1}));
+    }
+    SUBCASE("opening a store truncates it") {
+        {
+            ColdStore store(path, 1);
+            store.put("stale payload");
+        }
+        ColdStore store(path);
+        CHECK(store.get_size() == 0);
+        CHECK(std::filesystem::file_size(path) == 0);
+    }
+    SUBCASE("a live store is shared by path") {
+        auto store{ColdStore::open(path)};
+        [[maybe_unused]] const auto location{store->put("shared payload")};
+        auto again{ColdStore::open("/tmp/../tmp/" + std::filesystem::path(path).filename().string())};
+        CHECK(again == store);
+        store.reset();
+        CHECK(again->get(location) == "shared payload");
+        // once released, the next open truncates the file
+        again.reset();
+        CHECK(ColdStore::open(path)->get_size() == 0);
+    }
+    SUBCASE("concurrent readers and a writer") {
+        ColdStore store(path, 256);
+        std::vector<ColdStore::Location> locations;
+        for (size_t i{0}; i < 1000; ++i) locations.push_back(store.put("payload " + std::to_string(i)));
+        std::vector<std::thread> readers;
+        std::vector<size_t> mismatches(4, 0);
+        for (size_t r{0}; r < 4; ++r) {
+            readers.emplace_back([&store, &locations, &mismatches, r]() {
+                for (size_t i{r}; i < locations.size(); i += 4) {
+                    mismatches[r] += store.get(locations[i]) != "payload " + std::to_string(i);
+                }
+            });
+        }
+        for (size_t i{1000}; i < 2000; ++i) store.put("payload " + std::to_string(i));
+        for (auto& reader : readers) reader.join();
+        for ([[maybe_unused]] const auto& m : mismatches) CHECK(m == 0);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,60 @@
+#ifndef COLD_STORE_HEADER_FILE
+#define COLD_STORE_HEADER_FILE
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "unit_test.hpp"
+
+/* ColdStore
+
+  Purpose: on-disk tier for block payloads evicted from memory, payloads are
+           appended to one file (through a write buffer) and read back on
+           request with pread, safe to share between threads
+
+  Note: the store only holds copies of payloads of the chain in memory (the
+        write-ahead log is the durable record of the chain), so it is truncated
+        when opened and never synced
+
+        stores shared by path (ColdStore::open) are never truncated while one is
+        live, chains pruning to the same file append to the same store
+*/
+struct ColdStore {
+
+    // where a payload is stored
+    struct Location {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    // open (and truncate) the store, buffer is the number of bytes written at once
+    explicit ColdStore(const std::string&, const size_t& buffer = size_t{1} << 20);
+    // the live store opened by open for the path, or a new (truncated) one
+    static auto open(const std::string&) -> std::shared_ptr<ColdStore>;
+    ~ColdStore();
+
+    ColdStore(const ColdStore&) = delete;
+    auto operator=(const ColdStore&) -> ColdStore& = delete;
+
+    auto put(const std::string&) -> Location;
+    auto get(const Location&) const -> std::string; // throws std::runtime_error past the end of the store
+
+    auto get_path() const -> const std::string&;
+    auto get_size() const -> uint64_t; // bytes stored (written or buffered)
+
+    private:
+        const std::string path;
+        const size_t capacity; // of the write buffer
+        int fd;
+
+        mutable std::mutex mutex;
+        std::string buffer; // payloads not yet written, they start at offset written
+        uint64_t written;
+
+        auto flush() -> void; // write the buffer (mutex held)
+
+};
+
+#endif // COLD_STORE_HEADER_FILE
@@ -0,0 +1,277 @@
+/* farm
+
+  Purpose: in-process mining farm simulator, N virtual miners (threads) race
+           proofs of work on one shared chain, each miner sees the blocks of the
+           others only after a (configurable) network latency, a JSON report of
+           the effective throughput, the wasted work and the contention on the
+           chain tip is written
+
+  Usage: farm_blockchain [--<key> <value> ...]
+
+  Settings:
+    miners        number of virtual miners (threads)                        (8)
+    blocks        stop once this many blocks have been added to the chain   (200)
+    difficulty    difficulty of every block                                  (3)
+    latency_ms    propagation delay of a block to the other miners           (50)
+    jitter_ms     uniform random extra delay per block and miner             (0)
+    check_every   nonces tried between checks for a newer tip                (256)
+    seed          seed of the latency jitter and the miners' nonce offsets   (1)
+    output        report file (stdout when empty)
+
+  A miner that finds a proof submits it with check_parent + import_block (the
+  server.py flow), a block whose parent is no longer the tip is an orphan.
+  A miner that sees a newer tip while searching abandons its search. Hashes
+  spent on orphans and abandoned searches are wasted work.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blockchain.hpp"
+#include "sampling.hpp"
+
+struct Settings {
+    size_t miners{8};
+    size_t blocks{200};
+    size_t difficulty{3};
+    double latency_ms{50.0};
+    double jitter_ms{0.0};
+    size_t check_every{256};
+    uint64_t seed{1};
+    std::string output;
+};
+
+/* MinerStats
+
+  Purpose: what one virtual miner did
+*/
+struct MinerStats {
+    size_t hashes{0};
+    size_t accepted{0};       // blocks added to the chain
+    size_t orphaned{0};       // proofs found on a stale parent
+    size_t abandoned{0};      // searches given up for a newer tip
+    size_t wasted_hashes{0};  // hashes spent on orphans and abandoned searches
+    size_t stale_parent{0};   // submissions stopped by check_parent
+    std::vector<double> submit_us; // check_parent + import_block latency
+};
+
+/* Network
+
+  Purpose: the blocks added to the shared chain and when each miner sees them
+*/
+struct Network {
+
+    using Clock = std::chrono::steady_clock;
+
+    Network(const Settings& nsettings, const Block& genesis) : settings(nsettings) {
+        this->tips.push_back({genesis.get_index(), genesis.get_hash(), Clock::now(), this->settings.miners});
+    }
+
+    // record a block added to the chain by a miner
+    auto publish(const Block& block, const size_t& miner) -> void {
+        std::lock_guard lock(this->mutex);
+        this->tips.push_back({block.get_index(), block.get_hash(), Clock::now(), miner});
+    }
+
+    // the newest block the miner has seen (index, hash)
+    auto visible_tip(const size_t& miner) -> std::pair<size_t, std::string> {
+        const auto now{Clock::now()};
+        std::lock_guard lock(this->mutex);
+        for (auto it{this->tips.rbegin()}; it != this->tips.rend(); ++it) {
+            if (it->miner == miner || it->index == 0 || it->added + this->delay(it->index, miner) <= now) return {it->index, it->hash};
+        }
+        return {0, this->tips.front().hash};
+    }
+
+    private:
+        struct Tip {
+            size_t index;
+            std::string hash;
+            Clock::time_point added;
+            size_t miner;
+        };
+
+        const Settings& settings;
+        std::mutex mutex;
+        std::vector<Tip> tips;
+
+        // propagation delay of block index to the miner (the jitter is deterministic)
+        auto delay(const size_t& index, const size_t& miner) const -> Clock::duration {
+            uint64_t state{this->settings.seed ^ (index * 0x9e3779b97f4a7c15) ^ (miner << 32)};
+            const auto jitter{this->settings.jitter_ms * static_cast<double>(next_random(state) % 1000001) / 1e6};
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(this->settings.latency_ms + jitter));
+        }
+};
+
+/* mine
+
+  Purpose: run one virtual miner until the chain holds the requested number of blocks
+
+  Parameters: settings, the farm settings
+              id, the miner id
+              chain, the shared chain
+              network, the shared view of the published blocks
+              done, set once the chain is complete
+
+  Return: the miner statistics
+*/
+auto mine(const Settings& settings, const size_t& id, Blockchain& chain, Network& network, std::atomic<bool>& done) -> MinerStats {
+    MinerStats stats;
+    uint64_t state{settings.seed * 0xd1b54a32d192ed03 + id};
+    const std::string data{"block mined by miner " + std::to_string(id)};
+
+    while (!done) {
+        const auto [parent_index, parent]{network.visible_tip(id)};
+        const auto index{parent_index + 1};
+        const auto timestamp{time(nullptr)};
+        size_t nonce{next_random(state) >> 16}; // miners search different nonce ranges
+        size_t tried{0};
+        bool found{false}, stale{false};
+        std::string hash;
+        while (!found && !done) {
+            hash = Blockchain::calc_hash(nonce, index, timestamp, parent, data);
+            ++tried;
+            if (Blockchain::meets_difficulty(hash, settings.difficulty)) {
+                found = true;
+                break;
+            }
+            ++nonce;
+            if (tried % settings.check_every == 0 && network.visible_tip(id).first != parent_index) {
+                stale = true;
+                break;
+            }
+        }
+        stats.hashes += tried;
+        if (stale || !found) {
+            stats.abandoned += stale ? 1 : 0;
+            stats.wasted_hashes += tried;
+            continue;
+        }
+
+        const auto start{std::chrono::steady_clock::now()};
+        auto accepted{false};
+        if (!chain.check_parent(parent)) {
+            ++stats.stale_parent;
+        } else {
+            const Block block(nonce, index, timestamp, parent, data, hash);
+            accepted = chain.import_block(block);
+            if (accepted) network.publish(block, id);
+        }
+        stats.submit_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (accepted) {
+            ++stats.accepted;
+            if (chain.get_chain_length() > settings.blocks) done = true;
+        } else {
+            ++stats.orphaned;
+            stats.wasted_hashes += tried;
+        }
+    }
+    return stats;
+}
+
+auto apply_setting(Settings& settings, const std::string& key, const std::string& value) -> bool {
+    try {
+        if (key == "miners") settings.miners = std::max<size_t>(1, std::stoull(value));
+        else if (key == "blocks") settings.blocks = std::stoull(value);
+        else if (key == "difficulty") settings.difficulty = std::stoull(value);
+        else if (key == "latency_ms") settings.latency_ms = std::stod(value);
+        else if (key == "jitter_ms") settings.jitter_ms = std::stod(value);
+        else if (key == "check_every") settings.check_every = std::max<size_t>(1, std::stoull(value));
+        else if (key == "seed") settings.seed = std::stoull(value);
+        else if (key == "output") settings.output = value;
+        else return false;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+auto main(int argc, char** argv) -> int {
+
+    Settings settings;
+    for (int i{1}; i < argc; ++i) {
+        const std::string flag{argv[i]};
+        if (flag.rfind("--", 0) != 0 || i + 1 >= argc || !apply_setting(settings, flag.substr(2), argv[i + 1])) {
+            std::cerr << "usage: " << argv[0] << " [--<key> <value> ...] (see farm.cpp for the settings)\n";
+            return 1;
+        }
+        ++i;
+    }
+
+    Blockchain chain;
+    chain.set_difficulty(settings.difficulty);
+    Network network(settings, chain.get_end_of_chain());
+    std::atomic<bool> done{settings.blocks == 0};
+
+    std::vector<MinerStats> miners(settings.miners);
+    const auto start{std::chrono::steady_clock::now()};
+    {
+        std::vector<std::thread> threads;
+        for (size_t m{0}; m < settings.miners; ++m) {
+            threads.emplace_back([&, m]() { miners[m] = mine(settings, m, chain, network, done); });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+    const auto elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    MinerStats total;
+    std::stringstream shares;
+    for (size_t m{0}; m < miners.size(); ++m) {
+        const auto& stats{miners[m]};
+        total.hashes += stats.hashes;
+        total.accepted += stats.accepted;
+        total.orphaned += stats.orphaned;
+        total.abandoned += stats.abandoned;
+        total.wasted_hashes += stats.wasted_hashes;
+        total.stale_parent += stats.stale_parent;
+        total.submit_us.insert(total.submit_us.end(), stats.submit_us.begin(), stats.submit_us.end());
+        shares << (m ? ", " : "") << stats.accepted;
+    }
+    std::sort(total.submit_us.begin(), total.submit_us.end());
+    const auto found{total.accepted + total.orphaned};
+    const auto hashes{std::max<size_t>(1, total.hashes)};
+
+    std::stringstream report;
+    report << std::fixed << std::setprecision(3)
+           << "{\n"
+           << "  \"settings\": {\"miners\": " << settings.miners << ", \"blocks\": " << settings.blocks
+           << ", \"difficulty\": " << settings.difficulty << ", \"latency_ms\": " << settings.latency_ms
+           << ", \"jitter_ms\": " << settings.jitter_ms << ", \"check_every\": " << settings.check_every
+           << ", \"seed\": " << settings.seed << "},\n"
+           << "  \"throughput\": {\"elapsed_s\": " << elapsed << ", \"blocks\": " << total.accepted
+           << ", \"blocks_per_second\": " << total.accepted / elapsed << ", \"hashes_per_second\": " << total.hashes / elapsed
+           << ", \"hashes_per_block\": " << static_cast<double>(total.hashes) / std::max<size_t>(1, total.accepted) << "},\n"
+           << "  \"waste\": {\"orphans\": " << total.orphaned << ", \"orphan_rate\": "
+           << static_cast<double>(total.orphaned) / std::max<size_t>(1, found)
+           << ", \"abandoned_searches\": " << total.abandoned << ", \"wasted_hashes\": " << total.wasted_hashes
+           << ", \"wasted_work\": " << static_cast<double>(total.wasted_hashes) / static_cast<double>(hashes) << "},\n"
+           << "  \"tip_contention\": {\"submissions\": " << total.submit_us.size()
+           << ", \"stale_parent_rejections\": " << total.stale_parent
+           << ", \"import_rejections\": " << total.orphaned - total.stale_parent
+           << ", \"submit_us\": {\"p50\": " << percentile(total.submit_us, 50.0) << ", \"p99\": " << percentile(total.submit_us, 99.0)
+           << ", \"max\": " << (total.submit_us.empty() ? 0.0 : total.submit_us.back()) << "}},\n"
+           << "  \"blocks_per_miner\": [" << shares.str() << "]\n"
+           << "}\n";
+
+    if (settings.output.empty()) {
+        std::cout << report.str();
+    } else {
+        std::ofstream out(settings.output);
+        out << report.str();
+        out.close();
+        if (!out) {
+            std::cerr << "cannot write report: " << settings.output << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "hash_policy.hpp"
+
+auto hash_function_name(const HashFunction& function) -> std::string {
+    switch (function) {
+        case HashFunction::double_sha256: return "double-sha256";
+        case HashFunction::fnv1a: return "fnv1a";
+        case HashFunction::sha256: break;
+    }
+    return "sha256";
+}
+
+auto parse_hash_function(const std::string& name) -> std::optional<HashFunction> {
+    for (const auto function : {HashFunction::sha256, HashFunction::double_sha256, HashFunction::fnv1a}) {
+        if (hash_function_name(function) == name) return function;
+    }
+    return std::nullopt;
+}
+
+auto payload_preimage(const size_t& nonce, const size_t& index, const time_t& timestamp,
+                      const std::string& parent_hash, const std::string& data) -> std::string {
+    std::string preimage;
+    preimage.reserve(64 + parent_hash.size() + data.size());
+    preimage += std::to_string(nonce);
+    preimage += std::to_string(index);
+    preimage += std::to_string(timestamp);
+    preimage += parent_hash;
+    preimage += data;
+    return preimage;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Hash policies") {
+    SUBCASE("policies hash to 64 hex digits") {
+        CHECK(Sha256Hash::digest("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        CHECK(DoubleSha256Hash::digest("abc") == "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358");
+        CHECK(DoubleSha256Hash::digest("") == "5df6e0e2761359d30a8275058e299fcc0381534545f55cf43e41983f5d4c9456");
+        CHECK(Fnv1aHash::fnv1a("") == 0xcbf29ce484222325);
+        CHECK(Fnv1aHash::fnv1a("a") == 0xaf63dc4c8601ec8c);
+        const auto fnv{Fnv1aHash::digest("abc")};
+        CHECK(fnv.size() == 64);
+        CHECK(fnv.find_first_not_of("0123456789abcdef") == std::string::npos);
+        CHECK(fnv != Fnv1aHash::digest("abd"));
+    }
+    SUBCASE("a policy is picked by its tag") {
+        for ([[maybe_unused]] const auto function : {HashFunction::sha256, HashFunction::double_sha256, HashFunction::fnv1a}) {
+            CHECK(with_hash_policy(function, [](auto policy) { return decltype(policy)::tag; }) == function);
+            CHECK(parse_hash_function(hash_function_name(function)) == function);
+        }
+        CHECK(!parse_hash_function("md5"));
+    }
+    SUBCASE("the payload preimage") {
+        CHECK(payload_preimage(5, 12, 1700000000, "parent", "data") == "5121700000000parentdata");
+    }
+}
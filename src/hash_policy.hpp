@@ -0,0 +1,101 @@
+#ifndef HASH_POLICY_HEADER_FILE
+#define HASH_POLICY_HEADER_FILE
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+
+#include "sha256_fixed.hpp"
+#include "unit_test.hpp"
+#include "wire.hpp"
+
+/* hash policies
+
+  Purpose: the hash function of the proof of work (block hashes), selected per
+           chain at construction, each policy is a struct with a static digest
+           that maps a preimage to 64 lowercase hex digits, so hashes of every
+           policy compare, meet difficulties and encode the same way
+
+  Note: the hot loops (nonce search, mining slices, header verification) are
+        instantiated once per policy and the policy is picked once per call
+        (with_hash_policy), a hash is never an indirect call
+
+        payload digests (the digest commitment, BlockHeader::payload_digest)
+        are SHA-256 whatever the policy, only the proof of work changes
+*/
+enum class HashFunction : uint8_t {
+    sha256,        // SHA-256 (the original chain format)
+    double_sha256, // SHA-256 of the (raw) SHA-256
+    fnv1a          // FNV-1a, not cryptographic: test chains and measuring the cost around the hash
+};
+
+struct Sha256Hash {
+    static constexpr HashFunction tag{HashFunction::sha256};
+    static auto digest(const std::string& preimage) -> std::string {
+        return SHA256Fixed::digest(preimage);
+    }
+};
+
+struct DoubleSha256Hash {
+    static constexpr HashFunction tag{HashFunction::double_sha256};
+    static auto digest(const std::string& preimage) -> std::string {
+        std::string inner(32, '\0');
+        hash_to_bytes(SHA256Fixed::digest(preimage), reinterpret_cast<uint8_t*>(inner.data()));
+        return SHA256Fixed::to_hex(SHA256Fixed::hash_fixed<1>(inner));
+    }
+};
+
+struct Fnv1aHash {
+    static constexpr HashFunction tag{HashFunction::fnv1a};
+
+    // 64 bit FNV-1a
+    static auto fnv1a(const std::string& bytes) -> uint64_t {
+        uint64_t h{0xcbf29ce484222325};
+        for (const auto c : bytes) h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+        return h;
+    }
+
+    // FNV-1a widened to 256 bits with the splitmix64 finalizer (so leading digits are mixed)
+    static auto digest(const std::string& preimage) -> std::string {
+        static constexpr char digits[]{"0123456789abcdef"};
+        const auto h{Fnv1aHash::fnv1a(preimage)};
+        std::string hex(64, '0');
+        for (uint64_t lane{0}; lane < 4; ++lane) {
+            auto z{h + (lane + 1) * 0x9e3779b97f4a7c15};
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            z ^= z >> 31;
+            for (size_t i{0}; i < 16; ++i) hex[16 * lane + i] = digits[(z >> (60 - 4 * i)) & 0xF];
+        }
+        return hex;
+    }
+};
+
+/* with_hash_policy
+
+  Purpose: call f with the policy of a hash function (a default constructed
+           Sha256Hash, DoubleSha256Hash or Fnv1aHash), f is instantiated for
+           every policy
+
+  Return: what f returns
+*/
+template <typename F>
+auto with_hash_policy(const HashFunction& function, F&& f) -> decltype(f(Sha256Hash{})) {
+    switch (function) {
+        case HashFunction::double_sha256: return f(DoubleSha256Hash{});
+        case HashFunction::fnv1a: return f(Fnv1aHash{});
+        case HashFunction::sha256: break;
+    }
+    return f(Sha256Hash{});
+}
+
+// name of a hash function in chain-format tags ("sha256", "double-sha256", "fnv1a")
+auto hash_function_name(const HashFunction&) -> std::string;
+auto parse_hash_function(const std::string&) -> std::optional<HashFunction>;
+
+// the bytes a block hash covers with the payload commitment (nonce, index and
+// timestamp in decimal, then the parent hash and the raw data)
+auto payload_preimage(const size_t&, const size_t&, const time_t&, const std::string&, const std::string&) -> std::string;
+
+#endif // HASH_POLICY_HEADER_FILE
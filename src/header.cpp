@@ -0,0 +1,110 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "header.hpp"
+#include "sha256_fixed.hpp"
+#include "wire.hpp"
+
+/* preimage
+
+  Purpose: encode the hashed fields of a header (index, timestamp and nonce as
+           u64, the parent hash and the payload digest as 32 raw bytes each)
+
+  Parameters: index, timestamp, nonce, the block fields
+              parent, the parent hash (hex, empty for the genesis block)
+              payload_digest, SHA-256 of the block data (32 raw bytes)
+
+  Return: the 88 byte preimage (two SHA-256 blocks once padded)
+*/
+auto BlockHeader::preimage(const uint64_t& index, const int64_t& timestamp, const uint64_t& nonce,
+                           const std::string& parent, const std::string& payload_digest) -> std::string {
+    std::string out;
+    out.reserve(88);
+    put_u64(out, index);
+    put_u64(out, static_cast<uint64_t>(timestamp));
+    put_u64(out, nonce);
+    uint8_t parent_bytes[32];
+    hash_to_bytes(parent, parent_bytes);
+    out.append(reinterpret_cast<const char*>(parent_bytes), 32);
+    out.append(payload_digest, 0, 32);
+    out.resize(88, '\0');
+    return out;
+}
+
+auto BlockHeader::preimage() const -> std::string {
+    return BlockHeader::preimage(this->index, this->timestamp, this->nonce, bytes_to_hash(this->parent.data()),
+                                 std::string(reinterpret_cast<const char*>(this->payload_digest.data()), 32));
+}
+
+auto BlockHeader::check_payload(const std::string& data) const -> bool {
+    uint8_t digest[32];
+    hash_to_bytes(SHA256Fixed::digest(data), digest);
+    return std::memcmp(digest, this->payload_digest.data(), 32) == 0;
+}
+
+auto BlockHeader::encode(std::string& out) const -> void {
+    put_u64(out, this->index);
+    put_u64(out, static_cast<uint64_t>(this->timestamp));
+    put_u64(out, this->nonce);
+    out.append(reinterpret_cast<const char*>(this->parent.data()), 32);
+    out.append(reinterpret_cast<const char*>(this->payload_digest.data()), 32);
+    out.append(reinterpret_cast<const char*>(this->hash.data()), 32);
+}
+
+auto BlockHeader::decode(const std::string& in, size_t& pos) -> BlockHeader {
+    if (in.size() < BlockHeader::size || pos > in.size() - BlockHeader::size) throw std::runtime_error("header: truncated header");
+    BlockHeader header;
+    header.index = get_u64(in, pos);
+    header.timestamp = static_cast<int64_t>(get_u64(in, pos));
+    header.nonce = get_u64(in, pos);
+    for (auto field : {&header.parent, &header.payload_digest, &header.hash}) {
+        std::memcpy(field->data(), in.data() + pos, 32);
+        pos += 32;
+    }
+    return header;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Block headers") {
+    BlockHeader header{7, 1700000070, 12345, {}, {}, {}};
+    hash_to_bytes(SHA256Fixed::digest("parent"), header.parent.data());
+    hash_to_bytes(SHA256Fixed::digest("payload"), header.payload_digest.data());
+    hash_to_bytes(SHA256Fixed::digest(header.preimage()), header.hash.data());
+
+    SUBCASE("the encoding has a fixed size and round trips") {
+        std::string encoded;
+        header.encode(encoded);
+        header.encode(encoded);
+        CHECK(encoded.size() == 2 * BlockHeader::size);
+        size_t pos{BlockHeader::size};
+        [[maybe_unused]] const auto decoded{BlockHeader::decode(encoded, pos)};
+        CHECK(pos == encoded.size());
+        CHECK(decoded.index == 7);
+        CHECK(decoded.timestamp == 1700000070);
+        CHECK(decoded.nonce == 12345);
+        CHECK(decoded.parent == header.parent);
+        CHECK(decoded.payload_digest == header.payload_digest);
+        CHECK(decoded.hash == header.hash);
+        pos = 1;
+        CHECK_THROWS(BlockHeader::decode(encoded.substr(0, BlockHeader::size), pos));
+    }
+    SUBCASE("the preimage covers every field but the hash") {
+        const auto preimage{header.preimage()};
+        CHECK(preimage.size() == 88);
+        CHECK(preimage.substr(56) == std::string(reinterpret_cast<const char*>(header.payload_digest.data()), 32));
+        auto other{header};
+        other.hash[0] ^= 1;
+        CHECK(other.preimage() == preimage);
+        other.nonce += 1;
+        CHECK(other.preimage() != preimage);
+        // the genesis block has no parent, its parent bytes are zeros
+        CHECK(BlockHeader::preimage(0, 0, 0, "", std::string(32, '\0')) == std::string(88, '\0'));
+    }
+    SUBCASE("payloads are checked against their digest") {
+        CHECK(header.check_payload("payload"));
+        CHECK(!header.check_payload("payload "));
+        CHECK(!header.check_payload(""));
+    }
+}
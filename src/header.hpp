@@ -0,0 +1,45 @@
+#ifndef HEADER_HEADER_FILE
+#define HEADER_HEADER_FILE
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "unit_test.hpp"
+
+/* BlockHeader
+
+  Purpose: fixed-size block header for light clients, the block data is
+           committed by its SHA-256 digest, so a chain of headers can be
+           checked (linkage and proof of work) without holding any block data
+
+  Note: the proof of work of a header can only be re-computed for a block of
+        a chain that commits its data by digest (Blockchain::Commitment::digest),
+        the hash of a block of a legacy chain covers the data itself
+*/
+struct BlockHeader {
+
+    static constexpr size_t size{120}; // bytes of the encoding
+
+    uint64_t index;
+    int64_t timestamp;
+    uint64_t nonce;
+    std::array<uint8_t, 32> parent;         // hash of the parent block (zeros for the genesis block)
+    std::array<uint8_t, 32> payload_digest; // SHA-256 of the (raw) block data
+    std::array<uint8_t, 32> hash;
+
+    // the bytes the hash of a digest committed block covers (every field but the hash)
+    static auto preimage(const uint64_t&, const int64_t&, const uint64_t&, const std::string&, const std::string&) -> std::string;
+    auto preimage() const -> std::string;
+
+    // check that data is the block data the header commits to
+    auto check_payload(const std::string&) const -> bool;
+
+    // fixed-size little-endian encoding, decode advances the position and
+    // throws std::runtime_error on truncated input
+    auto encode(std::string&) const -> void;
+    static auto decode(const std::string&, size_t&) -> BlockHeader;
+
+};
+
+#endif // HEADER_HEADER_FILE
@@ -0,0 +1,287 @@
+/* loadgen
+
+  Purpose: non-interactive, reproducible load generation against the blockchain
+           engine, a workload (read from a spec file and/or the command line)
+           is mined and a JSON report is written
+
+  Usage: loadgen_blockchain [--spec <file>] [--<key> <value> ...]
+
+  Workload keys (spec files hold one `key = value` per line, '#' starts a comment):
+    blocks          number of blocks to mine per chain               (1000)
+    payload         payload size in bytes, `N` or uniform `MIN:MAX`   (256)
+    difficulty      `D` or a schedule of `height:D` steps, e.g. `0:1,500:2` (1)
+    max_iterations  maximum nonce per block                          (1000000)
+    threads         number of independent chains mined concurrently   (1)
+    seed            seed for the payload generator                   (1)
+    timestamp       genesis timestamp, block i is stamped timestamp + i * interval (1700000000)
+    interval        seconds between block timestamps                 (10)
+    output          report file (stdout when empty)
+
+  The `result` section of the report (chain digest, hash counts) is bit-for-bit
+  identical between runs of the same workload, the `timing` section is not.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "blockchain.hpp"
+#include "sampling.hpp"
+#include "sha256_fixed.hpp"
+
+/* Workload
+
+  Purpose: description of a reproducible run
+*/
+struct Workload {
+    size_t blocks{1000};
+    size_t payload_min{256};
+    size_t payload_max{256};
+    std::vector<std::pair<size_t, size_t>> difficulty_schedule{{0, 1}}; // (from height, difficulty)
+    size_t max_iterations{1000000};
+    size_t threads{1};
+    uint64_t seed{1};
+    time_t timestamp{1700000000};
+    time_t interval{10};
+    std::string output;
+};
+
+/* ChainResult
+
+  Purpose: outcome of mining one chain of the workload
+*/
+struct ChainResult {
+    size_t mined{0};
+    size_t failed{0};
+    size_t hashes{0};
+    std::string tip_hash;
+    std::vector<double> latencies_us; // per mine call
+};
+
+/* make_payload
+
+  Purpose: generate a JSON-like payload of exactly the requested size
+
+  Parameters: state, generator state
+              height, block height (part of the record)
+              size, payload size in bytes
+
+  Return: the payload
+*/
+auto make_payload(uint64_t& state, const size_t& height, const size_t& size) -> std::string {
+    std::string payload;
+    payload.reserve(size + 128);
+    while (payload.size() < size) {
+        const auto r{next_random(state)};
+        payload += "{\"height\":" + std::to_string(height) + ",\"account\":\"acct-" + std::to_string(r % 100000) +
+                   "\",\"amount\":" + std::to_string((r >> 20) % 1000000) + "}";
+    }
+    payload.resize(size);
+    return payload;
+}
+
+auto difficulty_at(const Workload& workload, const size_t& height) -> size_t {
+    size_t difficulty{0};
+    for (const auto& [from, d] : workload.difficulty_schedule) {
+        if (height >= from) difficulty = d;
+    }
+    return difficulty;
+}
+
+/* apply_setting
+
+  Purpose: set one workload key
+
+  Return: true if the key and value are valid,
+          false otherwise
+*/
+auto apply_setting(Workload& workload, const std::string& key, const std::string& value) -> bool {
+    try {
+        if (key == "blocks") workload.blocks = std::stoull(value);
+        else if (key == "max_iterations") workload.max_iterations = std::stoull(value);
+        else if (key == "threads") workload.threads = std::max<size_t>(1, std::stoull(value));
+        else if (key == "seed") workload.seed = std::stoull(value);
+        else if (key == "timestamp") workload.timestamp = std::stoll(value);
+        else if (key == "interval") workload.interval = std::stoll(value);
+        else if (key == "output") workload.output = value;
+        else if (key == "payload") {
+            const auto colon{value.find(':')};
+            workload.payload_min = std::stoull(value.substr(0, colon));
+            workload.payload_max = (colon == std::string::npos) ? workload.payload_min : std::stoull(value.substr(colon + 1));
+            if (workload.payload_max < workload.payload_min) return false;
+        }
+        else if (key == "difficulty") {
+            workload.difficulty_schedule.clear();
+            std::stringstream steps(value);
+            std::string step;
+            while (std::getline(steps, step, ',')) {
+                const auto colon{step.find(':')};
+                if (colon == std::string::npos) workload.difficulty_schedule.emplace_back(0, std::stoull(step));
+                else workload.difficulty_schedule.emplace_back(std::stoull(step.substr(0, colon)), std::stoull(step.substr(colon + 1)));
+            }
+            std::stable_sort(workload.difficulty_schedule.begin(), workload.difficulty_schedule.end());
+        }
+        else return false;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+auto trim(const std::string& s) -> std::string {
+    const auto first{s.find_first_not_of(" \t\r")};
+    if (first == std::string::npos) return "";
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+auto read_spec(Workload& workload, const std::string& path) -> bool {
+    std::ifstream spec(path);
+    if (!spec) {
+        std::cerr << "cannot open workload spec: " << path << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(spec, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        const auto eq{line.find('=')};
+        if (eq == std::string::npos || !apply_setting(workload, trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+            std::cerr << "invalid workload line: " << line << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/* mine_chain
+
+  Purpose: mine one chain of the workload
+
+  Parameters: workload, the workload
+              id, chain id (selects the payload stream)
+
+  Return: the chain result
+*/
+auto mine_chain(const Workload& workload, const size_t& id) -> ChainResult {
+    ChainResult result;
+    result.latencies_us.reserve(workload.blocks);
+    uint64_t state{workload.seed ^ (0xd1b54a32d192ed03 * (id + 1))};
+
+    Blockchain blockchain(workload.timestamp);
+    blockchain.set_max_iterations(workload.max_iterations);
+    const auto spread{workload.payload_max - workload.payload_min + 1};
+
+    for (size_t height{1}; height <= workload.blocks; ++height) {
+        blockchain.set_difficulty(difficulty_at(workload, height));
+        const auto size{workload.payload_min + next_random(state) % spread};
+        const auto payload{make_payload(state, height, size)};
+        const time_t timestamp{workload.timestamp + static_cast<time_t>(height) * workload.interval};
+
+        const auto start{std::chrono::steady_clock::now()};
+        const auto mined{blockchain.mine(payload, timestamp)};
+        const auto stop{std::chrono::steady_clock::now()};
+        result.latencies_us.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+
+        if (mined) {
+            ++result.mined;
+            result.hashes += blockchain.get_end_of_chain().get_nonce() + 1;
+        } else {
+            ++result.failed;
+            result.hashes += workload.max_iterations + 1;
+        }
+    }
+    result.tip_hash = blockchain.get_end_of_chain().get_hash();
+    return result;
+}
+
+auto main(int argc, char** argv) -> int {
+
+    Workload workload;
+    for (int i{1}; i < argc; ++i) {
+        const std::string flag{argv[i]};
+        if (flag.rfind("--", 0) != 0 || i + 1 >= argc) {
+            std::cerr << "usage: " << argv[0] << " [--spec <file>] [--<key> <value> ...]\n";
+            return 1;
+        }
+        const std::string value{argv[++i]};
+        if (flag == "--spec") {
+            if (!read_spec(workload, value)) return 1;
+        } else if (!apply_setting(workload, flag.substr(2), value)) {
+            std::cerr << "invalid setting: " << flag << " " << value << "\n";
+            return 1;
+        }
+    }
+
+    // every chain is mined on its own thread, results are merged in chain order
+    std::vector<ChainResult> results(workload.threads);
+    const auto start{std::chrono::steady_clock::now()};
+    {
+        std::vector<std::thread> miners;
+        for (size_t t{0}; t < workload.threads; ++t) {
+            miners.emplace_back([&workload, &results, t]() { results[t] = mine_chain(workload, t); });
+        }
+        for (auto& miner : miners) miner.join();
+    }
+    const auto elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    size_t mined{0}, failed{0}, hashes{0};
+    std::string tips;
+    std::vector<double> latencies;
+    for (const auto& result : results) {
+        mined += result.mined;
+        failed += result.failed;
+        hashes += result.hashes;
+        tips += result.tip_hash;
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::stringstream schedule;
+    for (size_t i{0}; i < workload.difficulty_schedule.size(); ++i) {
+        schedule << (i ? "," : "") << workload.difficulty_schedule[i].first << ":" << workload.difficulty_schedule[i].second;
+    }
+
+    std::stringstream report;
+    report << std::fixed << std::setprecision(3)
+           << "{\n"
+           << "  \"workload\": {\"blocks\": " << workload.blocks
+           << ", \"payload_min\": " << workload.payload_min << ", \"payload_max\": " << workload.payload_max
+           << ", \"difficulty\": \"" << schedule.str() << "\", \"max_iterations\": " << workload.max_iterations
+           << ", \"threads\": " << workload.threads << ", \"seed\": " << workload.seed
+           << ", \"timestamp\": " << workload.timestamp << ", \"interval\": " << workload.interval << "},\n"
+           << "  \"result\": {\"blocks_mined\": " << mined << ", \"blocks_failed\": " << failed
+           << ", \"hashes\": " << hashes << ", \"chain_digest\": \"" << SHA256Fixed::digest(tips) << "\"},\n"
+           << "  \"timing\": {\"elapsed_s\": " << elapsed
+           << ", \"blocks_per_second\": " << mined / elapsed << ", \"hashes_per_second\": " << hashes / elapsed
+           << ", \"latency_us\": {\"p50\": " << percentile(latencies, 50.0) << ", \"p90\": " << percentile(latencies, 90.0)
+           << ", \"p99\": " << percentile(latencies, 99.0) << ", \"p999\": " << percentile(latencies, 99.9)
+           << ", \"max\": " << (latencies.empty() ? 0.0 : latencies.back()) << "}"
+           << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}\n"
+           << "}\n";
+
+    if (workload.output.empty()) {
+        std::cout << report.str();
+    } else {
+        std::ofstream out(workload.output);
+        out << report.str();
+        out.close();
+        if (!out) {
+            std::cerr << "cannot write report: " << workload.output << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
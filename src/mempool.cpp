@@ -0,0 +1,321 @@
+#include <iterator>
+#include <stdexcept>
+
+#include "mempool.hpp"
+#include "sha256_fixed.hpp"
+
+Mempool::Mempool(const size_t& cap) :
+    memory_cap(cap), memory_usage(0), next_sequence(0), stats{0, 0, 0, 0, 0} {
+}
+
+auto Mempool::record_cost(const size_t& length) -> size_t {
+    return length + 64 + 128; // data, hex digest, map nodes and bookkeeping
+}
+
+/* add
+
+  Purpose: add a record to the mempool
+
+  Parameters: data, the record
+              priority, the record priority (e.g. its fee), higher is mined first
+
+  Return: true if the record was added,
+          false if it is already pending or does not fit under the memory cap
+
+  Side effects: lower ranked records may be evicted
+*/
+auto Mempool::add(const std::string& data, const uint64_t& priority) -> bool {
+    auto digest{SHA256Fixed::digest(data)}; // hashed before locking
+    std::lock_guard lock(this->mutex);
+    return this->insert({data, priority, this->next_sequence++, std::move(digest)});
+}
+
+auto Mempool::add_batch(const std::vector<std::string>& batch, const uint64_t& priority) -> size_t {
+    auto digests{SHA256Fixed::digest_batch(batch)}; // hashed on the engine pool before locking
+    size_t accepted{0};
+    std::lock_guard lock(this->mutex);
+    for (size_t i{0}; i < batch.size(); ++i) {
+        accepted += this->insert({batch[i], priority, this->next_sequence++, std::move(digests[i])}) ? 1 : 0;
+    }
+    return accepted;
+}
+
+/* insert
+
+  Purpose: index a record, evicting lower ranked records if the memory cap
+           would be exceeded (the lock must be held)
+
+  Return: true if the record was added,
+          false otherwise
+*/
+auto Mempool::insert(Record&& record) -> bool {
+    if (this->records.count(record.digest) != 0) {
+        ++this->stats.duplicates;
+        return false;
+    }
+    const auto cost{record_cost(record.data.size())};
+    const Rank rank{record.priority, record.sequence};
+
+    // make sure enough lower ranked records can be evicted before evicting any
+    size_t freeable{0};
+    size_t victims{0};
+    for (auto it{this->order.rbegin()}; it != this->order.rend() && this->memory_usage - freeable + cost > this->memory_cap; ++it) {
+        if (!(rank < it->first)) break;
+        freeable += record_cost(this->records.at(it->second).data.size());
+        ++victims;
+    }
+    if (this->memory_usage - freeable + cost > this->memory_cap) {
+        ++this->stats.rejected;
+        return false;
+    }
+    this->stats.evicted += victims;
+    this->memory_usage -= freeable;
+    for (; victims > 0; --victims) {
+        const auto last{std::prev(this->order.end())};
+        this->records.erase(last->second);
+        this->order.erase(last);
+    }
+
+    this->memory_usage += cost;
+    this->order.emplace(rank, record.digest);
+    auto digest{record.digest};
+    this->records.emplace(std::move(digest), std::move(record));
+    ++this->stats.accepted;
+    return true;
+}
+
+/* take
+
+  Purpose: remove the best ranked records that fit in a block
+
+  Parameters: max_bytes, the size of the block data (netstring encoded records)
+
+  Return: the records in rank order, records too large for the remaining space
+          are skipped (and stay pending)
+
+  Side effects: records too large for an empty block of max_bytes are dropped,
+                they would never be taken and would use up the skip budget
+*/
+auto Mempool::take(const size_t& max_bytes) -> std::vector<Record> {
+    constexpr size_t max_skipped{64}; // bounds the scan when the block is nearly full
+    std::vector<Record> taken;
+    size_t remaining{max_bytes};
+    size_t skipped{0};
+    std::lock_guard lock(this->mutex);
+    for (auto it{this->order.begin()}; it != this->order.end() && remaining >= BlockAssembler::encoded_size(0);) {
+        auto entry{this->records.find(it->second)};
+        const auto size{BlockAssembler::encoded_size(entry->second.data.size())};
+        if (size > max_bytes) {
+            ++this->stats.oversized;
+            this->memory_usage -= record_cost(entry->second.data.size());
+            this->records.erase(entry);
+            it = this->order.erase(it);
+            continue;
+        }
+        if (size > remaining) {
+            if (++skipped == max_skipped) break;
+            ++it;
+            continue;
+        }
+        remaining -= size;
+        this->memory_usage -= record_cost(entry->second.data.size());
+        taken.push_back(std::move(entry->second));
+        this->records.erase(entry);
+        it = this->order.erase(it);
+    }
+    return taken;
+}
+
+auto Mempool::requeue(std::vector<Record>& taken) -> void {
+    std::lock_guard lock(this->mutex);
+    for (auto& record : taken) {
+        if (this->insert(std::move(record))) --this->stats.accepted; // not a new arrival
+    }
+    taken.clear();
+}
+
+auto Mempool::contains(const std::string& data) const -> bool {
+    const auto digest{SHA256Fixed::digest(data)};
+    std::lock_guard lock(this->mutex);
+    return this->records.count(digest) != 0;
+}
+
+auto Mempool::size() const -> size_t {
+    std::lock_guard lock(this->mutex);
+    return this->records.size();
+}
+
+auto Mempool::get_memory_usage() const -> size_t {
+    std::lock_guard lock(this->mutex);
+    return this->memory_usage;
+}
+
+auto Mempool::get_memory_cap() const -> size_t {
+    return this->memory_cap;
+}
+
+auto Mempool::get_stats() const -> Stats {
+    std::lock_guard lock(this->mutex);
+    return this->stats;
+}
+
+BlockAssembler::BlockAssembler(Blockchain& chain, Mempool& pool, const size_t& max_bytes) :
+    blockchain(chain), mempool(pool), max_block_bytes(max_bytes) {
+}
+
+auto BlockAssembler::get_max_block_bytes() const -> size_t {
+    return this->max_block_bytes;
+}
+
+auto BlockAssembler::encoded_size(const size_t& length) -> size_t {
+    return std::to_string(length).size() + length + 2;
+}
+
+auto BlockAssembler::encode(const std::vector<Mempool::Record>& records) -> std::string {
+    size_t total{0};
+    for (const auto& record : records) total += encoded_size(record.data.size());
+    std::string data;
+    data.reserve(total);
+    for (const auto& record : records) {
+        data += std::to_string(record.data.size());
+        data += ':';
+        data += record.data;
+        data += ',';
+    }
+    return data;
+}
+
+auto BlockAssembler::decode(const std::string& data) -> std::vector<std::string> {
+    std::vector<std::string> records;
+    size_t pos{0};
+    while (pos < data.size()) {
+        const auto colon{data.find(':', pos)};
+        if (colon == std::string::npos || colon == pos || colon - pos > 20) throw std::runtime_error("netstring: missing length");
+        size_t length{0};
+        for (auto i{pos}; i < colon; ++i) {
+            if (data[i] < '0' || data[i] > '9') throw std::runtime_error("netstring: invalid length");
+            length = 10 * length + static_cast<size_t>(data[i] - '0');
+        }
+        if (length > data.size() - colon - 1 || data.size() - colon - 1 - length < 1 || data[colon + 1 + length] != ',') {
+            throw std::runtime_error("netstring: truncated record");
+        }
+        records.push_back(data.substr(colon + 1, length));
+        pos = colon + length + 2;
+    }
+    return records;
+}
+
+/* mine_next
+
+  Purpose: mine the next block from the best ranked pending records
+
+  Return: number of records in the mined block (0 if none was mined)
+
+  Side effects: records are removed from the mempool (requeued if mining fails)
+*/
+auto BlockAssembler::mine_next() -> size_t {
+    auto records{this->mempool.take(this->max_block_bytes)};
+    if (records.empty()) return 0;
+    if (this->blockchain.mine(encode(records))) return records.size();
+    this->mempool.requeue(records);
+    return 0;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Mempool ordering, deduplication and eviction") {
+    const auto cap{4 * Mempool::record_cost(10)};
+
+    SUBCASE("priority then arrival order") {
+        Mempool mempool(cap);
+        CHECK(mempool.add("low-a", 1));
+        CHECK(mempool.add("high", 5));
+        CHECK(mempool.add("low-b", 1));
+        CHECK(mempool.add("none"));
+        const auto taken{mempool.take(1000)};
+        REQUIRE(taken.size() == 4);
+        CHECK(taken[0].data == "high");
+        CHECK(taken[1].data == "low-a");
+        CHECK(taken[2].data == "low-b");
+        CHECK(taken[3].data == "none");
+        CHECK(mempool.size() == 0);
+        CHECK(mempool.get_memory_usage() == 0);
+    }
+    SUBCASE("duplicates are rejected while pending") {
+        Mempool mempool(cap);
+        CHECK(mempool.add("record"));
+        CHECK(!mempool.add("record", 9));
+        CHECK(mempool.contains("record"));
+        CHECK(mempool.get_stats().duplicates == 1);
+        mempool.take(1000);
+        CHECK(mempool.add("record"));
+    }
+    SUBCASE("lowest ranked records are evicted at the memory cap") {
+        Mempool mempool(cap);
+        CHECK(mempool.add_batch({"0123456789", "1123456789", "2123456789", "3123456789"}, 2) == 4);
+        CHECK(!mempool.add("4123456789", 1)); // ranks below everything pending
+        CHECK(mempool.add("5123456789", 3));
+        CHECK(mempool.size() == 4);
+        CHECK(!mempool.contains("3123456789")); // latest arrival at the lowest priority
+        CHECK(mempool.get_stats().evicted == 1);
+        CHECK(mempool.get_stats().rejected == 1);
+        CHECK(mempool.get_memory_usage() <= mempool.get_memory_cap());
+    }
+    SUBCASE("take packs records up to the block size") {
+        Mempool mempool(cap);
+        mempool.add("aaaaaaaaaa", 3);
+        mempool.add("bbbbbbbbbbbbbbbbbbbb", 2);
+        mempool.add("c", 1);
+        auto taken{mempool.take(2 * BlockAssembler::encoded_size(10))};
+        REQUIRE(taken.size() == 2); // the 20 byte record is skipped
+        CHECK(taken[1].data == "c");
+        CHECK(mempool.size() == 1);
+        mempool.requeue(taken);
+        CHECK(mempool.size() == 3);
+        CHECK(mempool.take(1000)[0].data == "aaaaaaaaaa");
+    }
+    SUBCASE("records larger than a block are dropped") {
+        Mempool mempool;
+        for (size_t i{0}; i < 100; ++i) mempool.add(std::string(100, 'x') + std::to_string(i), 9);
+        mempool.add("small", 1);
+        const auto taken{mempool.take(64)};
+        REQUIRE(taken.size() == 1);
+        CHECK(taken[0].data == "small");
+        CHECK(mempool.size() == 0);
+        CHECK(mempool.get_memory_usage() == 0);
+        CHECK(mempool.get_stats().oversized == 100);
+    }
+}
+
+TEST_CASE("Block assembly") {
+    Blockchain blockchain(1700000000);
+    blockchain.set_difficulty(1);
+    Mempool mempool;
+    BlockAssembler assembler(blockchain, mempool, 64);
+
+    CHECK(BlockAssembler::decode(BlockAssembler::encode({{"ab", 0, 0, ""}, {"", 0, 1, ""}, {"x,y:z", 0, 2, ""}})) ==
+          std::vector<std::string>{"ab", "", "x,y:z"});
+    CHECK_THROWS(BlockAssembler::decode("3:ab,"));
+    CHECK_THROWS(BlockAssembler::decode("2:ab;"));
+    CHECK_THROWS(BlockAssembler::decode("x:ab,"));
+
+    CHECK(assembler.mine_next() == 0);
+    for (size_t i{0}; i < 10; ++i) mempool.add("record " + std::to_string(i), i % 2);
+    CHECK(assembler.mine_next() == 5); // 5 netstrings of 11 bytes fit in 64
+    CHECK(blockchain.get_chain_length() == 2);
+    const auto records{BlockAssembler::decode(blockchain.get_end_of_chain().get_data())};
+    CHECK(records.front() == "record 1");
+    CHECK(records.back() == "record 9");
+    CHECK(assembler.mine_next() == 5);
+    CHECK(BlockAssembler::decode(blockchain.get_end_of_chain().get_data()).front() == "record 0");
+    CHECK(mempool.size() == 0);
+
+    // failed mining puts the records back
+    mempool.add("unlucky");
+    blockchain.set_difficulty(64);
+    blockchain.set_max_iterations(10);
+    CHECK(assembler.mine_next() == 0);
+    CHECK(mempool.contains("unlucky"));
+    CHECK(mempool.get_stats().accepted == 11);
+}
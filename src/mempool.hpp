@@ -0,0 +1,110 @@
+#ifndef MEMPOOL_HEADER_FILE
+#define MEMPOOL_HEADER_FILE
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blockchain.hpp"
+
+/* Mempool
+
+  Purpose: pending records waiting to be mined, safe to share between threads
+
+           - records are deduplicated by their SHA-256 digest (while pending)
+           - records are taken by priority (highest first), then by arrival
+           - when the memory cap is reached, the lowest ranked records are
+             evicted to make room for better ranked ones
+*/
+struct Mempool {
+
+    struct Record {
+        std::string data;
+        uint64_t priority;
+        uint64_t sequence; // arrival order
+        std::string digest;
+    };
+
+    struct Stats {
+        size_t accepted;
+        size_t duplicates;
+        size_t evicted;
+        size_t rejected; // did not fit under the memory cap
+        size_t oversized; // dropped by take, larger than a whole block
+    };
+
+    explicit Mempool(const size_t& memory_cap = size_t{64} << 20);
+
+    // add a record, returns false for duplicates and records that do not fit
+    auto add(const std::string&, const uint64_t& priority = 0) -> bool;
+    // add several records under one lock, returns the number accepted
+    auto add_batch(const std::vector<std::string>&, const uint64_t& priority = 0) -> size_t;
+
+    // remove the best ranked records whose netstring encodings fit in the given number of bytes
+    // (records that could not fit even in an empty block are dropped)
+    auto take(const size_t&) -> std::vector<Record>;
+    // return taken records (e.g. when mining failed), they keep their place
+    auto requeue(std::vector<Record>&) -> void;
+
+    auto contains(const std::string&) const -> bool; // by record
+    auto size() const -> size_t;
+    auto get_memory_usage() const -> size_t;
+    auto get_memory_cap() const -> size_t;
+    auto get_stats() const -> Stats;
+
+    // accounted size of a pending record (data, digest and index overhead)
+    static auto record_cost(const size_t&) -> size_t;
+
+    private:
+        // ranking: higher priority first, then earlier arrival
+        struct Rank {
+            uint64_t priority;
+            uint64_t sequence;
+            auto operator<(const Rank& other) const -> bool {
+                return (this->priority != other.priority) ? this->priority > other.priority : this->sequence < other.sequence;
+            }
+        };
+
+        mutable std::mutex mutex;
+        std::map<Rank, std::string> order; // rank -> digest
+        std::unordered_map<std::string, Record> records; // digest -> record
+        const size_t memory_cap;
+        size_t memory_usage;
+        uint64_t next_sequence;
+        Stats stats;
+
+        auto insert(Record&&) -> bool; // caller holds the lock
+
+};
+
+/* BlockAssembler
+
+  Purpose: pack pending records into blocks, the block data is the
+           concatenation of netstrings ("<length>:<record>,") so that many
+           records share one proof of work
+*/
+struct BlockAssembler {
+
+    BlockAssembler(Blockchain&, Mempool&, const size_t& max_block_bytes = size_t{1} << 20);
+
+    // mine the next block from the mempool, returns the number of records it holds
+    // (0 when the mempool is empty or mining failed, the records are then requeued)
+    auto mine_next() -> size_t;
+
+    auto get_max_block_bytes() const -> size_t;
+
+    static auto encode(const std::vector<Mempool::Record>&) -> std::string;
+    static auto decode(const std::string&) -> std::vector<std::string>; // throws std::runtime_error on malformed data
+    static auto encoded_size(const size_t&) -> size_t; // netstring size of a record
+
+    private:
+        Blockchain& blockchain;
+        Mempool& mempool;
+        const size_t max_block_bytes;
+
+};
+
+#endif // MEMPOOL_HEADER_FILE
@@ -0,0 +1,623 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <queue>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "node.hpp"
+#include "wire.hpp"
+
+namespace {
+
+    // message types (each frame is a u32 payload length, a u8 type and the payload)
+    enum : uint8_t {
+        get_tip = 0x01,     // -> tip
+        tip = 0x02,         // u64 chain length, bytes tip hash
+        announce_tip = 0x03,// u64 chain length, bytes tip hash, bytes announcer address -> ack
+        ack = 0x04,
+        get_headers = 0x05, // u64 from, u64 count -> headers
+        headers = 0x06,     // u32 n, n x (u64 index, u64 timestamp, u64 nonce, bytes parent, bytes hash)
+        get_bodies = 0x07,  // u64 from, u64 count -> bodies
+        bodies = 0x08,      // u32 n, n x bytes data (n may be short of count, see max_bodies_reply)
+        error = 0x7F
+    };
+
+    // a frame read allocates its payload up front, so a peer may make the node allocate
+    // at most max_frame bytes, body replies stop at max_bodies_reply bytes (but hold at
+    // least one body), so blocks of up to max_frame - max_bodies_reply bytes sync
+    constexpr size_t max_frame{size_t{64} << 20};
+    constexpr size_t max_bodies_reply{size_t{16} << 20};
+    constexpr size_t header_batch{2000}; // headers per request
+    constexpr size_t body_batch{500};    // bodies per request
+    constexpr size_t batches_in_flight{8}; // per download connection
+
+    struct Header {
+        size_t index;
+        time_t timestamp;
+        size_t nonce;
+        std::string parent;
+        std::string hash;
+    };
+
+    /* open_socket
+
+      Purpose: open a listening or a connected socket for an address
+
+      Parameters: address, "unix:<path>" or "tcp:<host>:<port>"
+                  listening, true to bind and listen, false to connect
+
+      Return: the socket file descriptor (-1 on failure)
+    */
+    auto open_socket(const std::string& address, const bool& listening) -> int {
+        if (address.rfind("unix:", 0) == 0) {
+            const auto path{address.substr(5)};
+            sockaddr_un addr{};
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) return -1;
+            addr.sun_family = AF_UNIX;
+            std::copy(path.begin(), path.end(), addr.sun_path);
+            const int fd{socket(AF_UNIX, SOCK_STREAM, 0)};
+            if (fd < 0) return -1;
+            if (listening) {
+                unlink(path.c_str());
+                if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && ::listen(fd, 64) == 0) return fd;
+            } else if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                return fd;
+            }
+            close(fd);
+            return -1;
+        }
+        if (address.rfind("tcp:", 0) == 0) {
+            const auto colon{address.rfind(':')};
+            if (colon <= 3) return -1;
+            const auto host{address.substr(4, colon - 4)};
+            const auto port{address.substr(colon + 1)};
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = listening ? AI_PASSIVE : 0;
+            addrinfo* found{nullptr};
+            if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0) return -1;
+            int fd{-1};
+            for (auto info{found}; info != nullptr && fd < 0; info = info->ai_next) {
+                fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+                if (fd < 0) continue;
+                const int on{1};
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                if (listening) {
+                    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+                    if (bind(fd, info->ai_addr, info->ai_addrlen) == 0 && ::listen(fd, 64) == 0) break;
+                } else if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+                    break;
+                }
+                close(fd);
+                fd = -1;
+            }
+            freeaddrinfo(found);
+            return fd;
+        }
+        return -1;
+    }
+
+    auto send_all(const int fd, const char* data, size_t len) -> bool {
+        while (len > 0) {
+            const auto sent{send(fd, data, len, MSG_NOSIGNAL)};
+            if (sent <= 0) return false;
+            data += sent;
+            len -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    auto recv_all(const int fd, char* data, size_t len) -> bool {
+        while (len > 0) {
+            const auto received{recv(fd, data, len, 0)};
+            if (received <= 0) return false;
+            data += received;
+            len -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    auto write_frame(const int fd, const uint8_t& type, const std::string& payload) -> bool {
+        std::string frame;
+        frame.reserve(5 + payload.size());
+        put_u32(frame, static_cast<uint32_t>(payload.size()));
+        frame.push_back(static_cast<char>(type));
+        frame += payload;
+        return send_all(fd, frame.data(), frame.size());
+    }
+
+    auto read_frame(const int fd, uint8_t& type, std::string& payload) -> bool {
+        std::string head(5, '\0');
+        if (!recv_all(fd, head.data(), head.size())) return false;
+        size_t pos{0};
+        const auto len{get_u32(head, pos)};
+        if (len > max_frame) return false;
+        type = static_cast<uint8_t>(head[4]);
+        payload.resize(len);
+        return recv_all(fd, payload.data(), len);
+    }
+
+    // send a request and read the reply, returns false on failure or an unexpected reply
+    auto request(const int fd, const uint8_t& type, const std::string& payload, const uint8_t& expected, std::string& reply) -> bool {
+        uint8_t reply_type;
+        return write_frame(fd, type, payload) && read_frame(fd, reply_type, reply) && reply_type == expected;
+    }
+
+    auto range_request(const size_t& from, const size_t& count) -> std::string {
+        std::string payload;
+        put_u64(payload, from);
+        put_u64(payload, count);
+        return payload;
+    }
+
+}
+
+Node::Node(Blockchain& chain) :
+    blockchain(chain), listen_fd(-1), running(false), active_handlers(0), syncing(false) {
+    this->blockchain.pin_difficulty(true);
+}
+
+Node::~Node() {
+    this->stop();
+    this->blockchain.pin_difficulty(false);
+}
+
+auto Node::get_address() const -> std::string {
+    return this->address;
+}
+
+/* listen
+
+  Purpose: serve the chain (tips, headers, bodies, announcements) to peers
+
+  Parameters: addr, the address to listen at
+
+  Return: true if the node is listening
+          false otherwise (or if it is already listening)
+
+  Side effects: starts the connection acceptor thread
+*/
+auto Node::listen(const std::string& addr) -> bool {
+    if (this->running) return false;
+    this->listen_fd = open_socket(addr, true);
+    if (this->listen_fd < 0) return false;
+    this->address = addr;
+    this->running = true;
+    this->acceptor = std::thread(&Node::accept_loop, this);
+    return true;
+}
+
+/* stop
+
+  Purpose: stop serving peers, open connections are closed and all
+           node threads are joined
+
+  Side effects: a unix socket file is removed
+*/
+auto Node::stop() -> void {
+    if (this->running.exchange(false)) {
+        shutdown(this->listen_fd, SHUT_RDWR);
+        close(this->listen_fd);
+        if (this->acceptor.joinable()) this->acceptor.join();
+        if (this->address.rfind("unix:", 0) == 0) unlink(this->address.substr(5).c_str());
+        std::unique_lock lock(this->handlers_mutex);
+        for (const auto fd : this->handler_fds) shutdown(fd, SHUT_RDWR);
+        this->handlers_done.wait(lock, [this]() { return this->active_handlers == 0; });
+    }
+    std::lock_guard lock(this->sync_mutex);
+    if (this->background_sync.joinable()) this->background_sync.join();
+}
+
+auto Node::accept_loop() -> void {
+    while (this->running) {
+        const int fd{accept(this->listen_fd, nullptr, nullptr)};
+        if (fd < 0) {
+            if (!this->running) break;
+            continue;
+        }
+        std::lock_guard lock(this->handlers_mutex);
+        if (!this->running) {
+            close(fd);
+            break;
+        }
+        this->handler_fds.push_back(fd);
+        ++this->active_handlers;
+        std::thread(&Node::serve, this, fd).detach();
+    }
+}
+
+/* serve
+
+  Purpose: answer the requests of one peer connection until it closes
+
+  Parameters: fd, the connection
+*/
+auto Node::serve(const int fd) -> void {
+    uint8_t type;
+    std::string payload;
+    while (this->running && read_frame(fd, type, payload)) {
+        std::string reply;
+        uint8_t reply_type{error};
+        try {
+            size_t pos{0};
+            switch (type) {
+                case get_tip: {
+                    const auto last_block{this->blockchain.get_end_of_chain()};
+                    put_u64(reply, last_block.get_index() + 1);
+                    put_bytes(reply, last_block.get_hash());
+                    reply_type = tip;
+                    break;
+                }
+                case get_headers:
+                case get_bodies: {
+                    const auto from{get_u64(payload, pos)};
+                    const auto count{std::min<uint64_t>(get_u64(payload, pos), type == get_headers ? header_batch : body_batch)};
+                    const auto blocks{this->blockchain.get_blocks(from, count)};
+                    if (type == get_bodies) {
+                        std::string data;
+                        size_t n{0};
+                        for (; n < blocks.size() && (n == 0 || data.size() < max_bodies_reply); ++n) put_bytes(data, blocks[n].get_data());
+                        put_u32(reply, static_cast<uint32_t>(n));
+                        reply += data;
+                        reply_type = bodies;
+                        break;
+                    }
+                    put_u32(reply, static_cast<uint32_t>(blocks.size()));
+                    for (const auto& block : blocks) {
+                        put_u64(reply, block.get_index());
+                        put_u64(reply, static_cast<uint64_t>(block.get_timestamp()));
+                        put_u64(reply, block.get_nonce());
+                        put_bytes(reply, block.get_parent_hash());
+                        put_bytes(reply, block.get_hash());
+                    }
+                    reply_type = headers;
+                    break;
+                }
+                case announce_tip: {
+                    const auto length{get_u64(payload, pos)};
+                    const auto tip_hash{get_bytes(payload, pos)};
+                    const auto from{get_bytes(payload, pos)};
+                    reply_type = ack;
+                    // only a longer chain is worth syncing to
+                    if (length > this->blockchain.get_chain_length() && !from.empty()) this->start_background_sync(from);
+                    break;
+                }
+                default:
+                    break;
+            }
+        } catch (const std::runtime_error&) {
+            reply_type = error;
+            reply.clear();
+        }
+        if (!write_frame(fd, reply_type, reply) || reply_type == error) break;
+    }
+    close(fd);
+    std::lock_guard lock(this->handlers_mutex);
+    this->handler_fds.erase(std::find(this->handler_fds.begin(), this->handler_fds.end(), fd));
+    --this->active_handlers;
+    this->handlers_done.notify_all();
+}
+
+auto Node::add_peer(const std::string& peer) -> void {
+    std::lock_guard lock(this->peers_mutex);
+    if (std::find(this->peers.begin(), this->peers.end(), peer) == this->peers.end()) this->peers.push_back(peer);
+}
+
+/* mine
+
+  Purpose: mine a block and announce the new tip to all peers
+
+  Parameters: data, the block data
+
+  Return: true if the block was mined,
+          false otherwise
+*/
+auto Node::mine(const std::string& data) -> bool {
+    if (!this->blockchain.mine(data)) return false;
+    this->announce();
+    return true;
+}
+
+// announce the chain tip to every peer, returns the number of peers reached
+auto Node::announce() -> size_t {
+    std::vector<std::string> targets;
+    {
+        std::lock_guard lock(this->peers_mutex);
+        targets = this->peers;
+    }
+    size_t reached{0};
+    for (const auto& peer : targets) reached += this->announce_to(peer) ? 1 : 0;
+    return reached;
+}
+
+auto Node::announce_to(const std::string& peer) -> bool {
+    const int fd{open_socket(peer, false)};
+    if (fd < 0) return false;
+    const auto last_block{this->blockchain.get_end_of_chain()};
+    std::string payload, reply;
+    put_u64(payload, last_block.get_index() + 1);
+    put_bytes(payload, last_block.get_hash());
+    put_bytes(payload, this->address);
+    const auto acked{request(fd, announce_tip, payload, ack, reply)};
+    close(fd);
+    return acked;
+}
+
+auto Node::start_background_sync(const std::string& peer) -> void {
+    std::lock_guard lock(this->sync_mutex);
+    if (!this->running || this->syncing.exchange(true)) return; // one sync at a time
+    if (this->background_sync.joinable()) this->background_sync.join();
+    this->background_sync = std::thread([this, peer]() {
+        try {
+            this->sync_from(peer);
+        } catch (const std::exception&) {
+            // a failed sync leaves the chain as it is, a later announcement retries
+        }
+        this->syncing = false;
+    });
+}
+
+/* sync_from
+
+  Purpose: catch up with a peer, headers are fetched (and their linkage checked)
+           on one connection while bodies are downloaded in parallel batches on
+           the others, downloaded batches are validated and imported in order
+
+  Parameters: peer, the peer address
+              connections, number of body download connections
+
+  Return: number of blocks imported (the sync stops at the first invalid block,
+          and does not follow a peer whose chain forks from this one)
+
+  Side effects: blocks are imported into the chain
+*/
+auto Node::sync_from(const std::string& peer, const size_t& connections) -> size_t {
+
+    const int control{open_socket(peer, false)};
+    if (control < 0) return 0;
+
+    std::string reply;
+    size_t remote_length{0};
+    if (request(control, get_tip, "", tip, reply) && reply.size() >= 8) {
+        size_t pos{0};
+        remote_length = get_u64(reply, pos);
+    }
+    const auto last_block{this->blockchain.get_end_of_chain()};
+    size_t from{last_block.get_index() + 1};
+    if (remote_length <= from) {
+        close(control);
+        return 0;
+    }
+
+    struct Batch {
+        std::vector<Header> headers;
+        std::vector<std::string> bodies;
+        bool ready{false};
+    };
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<Batch>> pending; // batches in chain order (awaiting import)
+    std::queue<std::shared_ptr<Batch>> downloads; // batches awaiting their bodies
+    bool headers_done{false}, failed{false};
+    size_t imported{0};
+    const auto workers{std::max<size_t>(1, connections)};
+
+    // body download connections
+    std::vector<std::thread> downloaders;
+    for (size_t w{0}; w < workers; ++w) {
+        downloaders.emplace_back([&]() {
+            const int fd{open_socket(peer, false)};
+            for (;;) {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock lock(mutex);
+                    changed.wait(lock, [&]() { return failed || !downloads.empty() || headers_done; });
+                    if (failed || downloads.empty()) break;
+                    batch = downloads.front();
+                    downloads.pop();
+                }
+                std::string body_reply;
+                std::vector<std::string> batch_bodies;
+                // a reply may hold fewer bodies than asked for (max_bodies_reply), the rest is asked for again
+                auto ok{fd >= 0};
+                while (ok && batch_bodies.size() < batch->headers.size()) {
+                    const auto have{batch_bodies.size()};
+                    ok = request(fd, get_bodies, range_request(batch->headers.front().index + have, batch->headers.size() - have), bodies, body_reply);
+                    try {
+                        size_t pos{0};
+                        const auto n{ok ? get_u32(body_reply, pos) : 0};
+                        for (size_t i{0}; i < n && batch_bodies.size() < batch->headers.size(); ++i) batch_bodies.push_back(get_bytes(body_reply, pos));
+                        ok = ok && n > 0;
+                    } catch (const std::runtime_error&) {
+                        ok = false;
+                    }
+                }
+                std::lock_guard lock(mutex);
+                if (!ok || batch_bodies.size() != batch->headers.size()) failed = true;
+                batch->bodies = std::move(batch_bodies);
+                batch->ready = true;
+                changed.notify_all();
+            }
+            if (fd >= 0) close(fd);
+        });
+    }
+
+    // validation (in chain order) overlaps with the downloads
+    std::thread validator([&]() {
+        for (;;) {
+            std::shared_ptr<Batch> batch;
+            {
+                std::unique_lock lock(mutex);
+                changed.wait(lock, [&]() { return failed || (!pending.empty() && pending.front()->ready) || (headers_done && pending.empty()); });
+                if (failed || pending.empty()) break;
+                batch = pending.front();
+            }
+            size_t accepted{0};
+            for (size_t i{0}; i < batch->headers.size(); ++i) {
+                const auto& h{batch->headers[i]};
+                if (!this->blockchain.import_block(Block(h.nonce, h.index, h.timestamp, h.parent, batch->bodies[i], h.hash))) break;
+                ++accepted;
+            }
+            std::lock_guard lock(mutex);
+            imported += accepted;
+            if (accepted != batch->headers.size()) failed = true;
+            pending.pop_front();
+            changed.notify_all();
+        }
+    });
+
+    // header-first: fetch headers and check their linkage before any body is requested
+    const size_t difficulty{this->blockchain.get_difficulty()};
+    auto previous_hash{last_block.get_hash()};
+    while (from < remote_length) {
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&]() { return failed || pending.size() < batches_in_flight * workers; });
+            if (failed) break;
+        }
+        std::vector<Header> fetched;
+        auto ok{request(control, get_headers, range_request(from, std::min(header_batch, remote_length - from)), headers, reply)};
+        try {
+            size_t pos{0};
+            const auto n{ok ? get_u32(reply, pos) : 0};
+            for (size_t i{0}; i < n; ++i) {
+                Header h;
+                h.index = get_u64(reply, pos);
+                h.timestamp = static_cast<time_t>(get_u64(reply, pos));
+                h.nonce = get_u64(reply, pos);
+                h.parent = get_bytes(reply, pos);
+                h.hash = get_bytes(reply, pos);
+                if (h.index != from + i || h.parent != previous_hash || !Blockchain::meets_difficulty(h.hash, difficulty)) {
+                    ok = false;
+                    break;
+                }
+                previous_hash = h.hash;
+                fetched.push_back(std::move(h));
+            }
+        } catch (const std::runtime_error&) {
+            ok = false;
+        }
+        std::lock_guard lock(mutex);
+        for (size_t i{0}; i < fetched.size(); i += body_batch) {
+            auto batch{std::make_shared<Batch>()};
+            batch->headers.assign(fetched.begin() + i, fetched.begin() + std::min(fetched.size(), i + body_batch));
+            pending.push_back(batch);
+            downloads.push(batch);
+        }
+        from += fetched.size();
+        changed.notify_all();
+        if (!ok || fetched.empty()) break;
+    }
+    {
+        std::lock_guard lock(mutex);
+        headers_done = true;
+        changed.notify_all();
+    }
+    for (auto& downloader : downloaders) downloader.join();
+    validator.join();
+    close(control);
+    return imported;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Node block propagation") {
+    const auto base{"unix:/tmp/blockchain_node_test_" + std::to_string(getpid())};
+    Blockchain source(1700000000);
+    source.set_difficulty(1);
+    for (size_t i{1}; i <= 1200; ++i) source.mine("block " + std::to_string(i), 1700000000 + 10 * i);
+    Node server(source);
+    REQUIRE(server.listen(base + "_a.sock"));
+
+    SUBCASE("header-first sync with parallel body download") {
+        Blockchain replica(1700000000);
+        replica.set_difficulty(1);
+        Node node(replica);
+        CHECK(node.sync_from(server.get_address(), 3) == 1200);
+        CHECK(replica.get_chain_length() == source.get_chain_length());
+        CHECK(replica.get_end_of_chain().get_hash() == source.get_end_of_chain().get_hash());
+        CHECK(replica.get_block(600).get_data() == "block 600");
+        CHECK(node.sync_from(server.get_address(), 3) == 0);
+        // peers share one difficulty, it is pinned while a node is attached
+        CHECK_THROWS(replica.set_difficulty(2));
+        CHECK_NOTHROW(replica.set_difficulty(1));
+    }
+    SUBCASE("announcements trigger a sync") {
+        Blockchain replica(1700000000);
+        Node node(replica);
+        REQUIRE(node.listen(base + "_b.sock"));
+        server.add_peer(node.get_address());
+        CHECK(server.announce() == 1);
+        for (size_t wait{0}; wait < 500 && replica.get_chain_length() < source.get_chain_length(); ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(replica.get_chain_length() == source.get_chain_length());
+        node.stop();
+    }
+    SUBCASE("a forked chain is not followed") {
+        Blockchain fork(1700000000);
+        fork.mine("another block 1", 1700000010);
+        Node node(fork);
+        CHECK(node.sync_from(server.get_address()) == 0);
+        CHECK(fork.get_chain_length() == 2);
+    }
+    SUBCASE("body replies are split at max_bodies_reply") {
+        Blockchain large(1700000000);
+        for (size_t i{1}; i <= 40; ++i) large.mine(std::string(size_t{1} << 20, static_cast<char>('a' + i % 26)), 1700000000 + 10 * i);
+        Node large_server(large);
+        REQUIRE(large_server.listen(base + "_large.sock"));
+        Blockchain replica(1700000000);
+        Node node(replica);
+        CHECK(node.sync_from(large_server.get_address(), 1) == 40);
+        CHECK(replica.get_end_of_chain().get_hash() == large.get_end_of_chain().get_hash());
+        large_server.stop();
+    }
+    SUBCASE("malformed replies from a peer do not stop the node") {
+        // a peer that answers every request with a truncated tip
+        const auto fake_address{base + "_fake.sock"};
+        const int listener{open_socket(fake_address, true)};
+        REQUIRE(listener >= 0);
+        std::thread fake([listener]() {
+            for (size_t c{0}; c < 2; ++c) {
+                const int fd{accept(listener, nullptr, nullptr)};
+                if (fd < 0) return;
+                uint8_t type;
+                std::string payload;
+                if (read_frame(fd, type, payload)) write_frame(fd, tip, std::string(3, '\x05'));
+                close(fd);
+            }
+        });
+        Blockchain replica(1700000000);
+        Node node(replica);
+        CHECK(node.sync_from(fake_address) == 0);
+        // an announcement naming the peer syncs from it in the background
+        REQUIRE(node.listen(base + "_c.sock"));
+        const int fd{open_socket(node.get_address(), false)};
+        std::string payload, reply;
+        put_u64(payload, 100);
+        put_bytes(payload, "tip");
+        put_bytes(payload, fake_address);
+        CHECK(request(fd, announce_tip, payload, ack, reply));
+        close(fd);
+        fake.join();
+        node.stop();
+        close(listener);
+        CHECK(replica.get_chain_length() == 1);
+    }
+    SUBCASE("unreachable peers") {
+        Blockchain replica(1700000000);
+        Node node(replica);
+        CHECK(node.sync_from(base + "_missing.sock") == 0);
+        CHECK(!node.listen("bogus:address"));
+    }
+    server.stop();
+}
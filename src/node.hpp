@@ -0,0 +1,76 @@
+#ifndef NODE_HEADER_FILE
+#define NODE_HEADER_FILE
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blockchain.hpp"
+
+/* Node
+
+  Purpose: propagate blocks between backend processes that each hold a chain,
+           over TCP or Unix sockets (addresses are "unix:<path>" or "tcp:<host>:<port>")
+
+           - compact announcements: a node announces its chain length and tip digest,
+             a peer that is behind syncs from the announcing node
+           - header-first sync: headers are fetched and their linkage checked first,
+           - bodies are then downloaded over several connections in parallel while
+             already downloaded blocks are validated (and imported) in order
+
+  Note: blocks are checked against the difficulty of the receiving chain, every
+        peer must use the same difficulty, it is pinned while the node exists
+*/
+struct Node {
+
+    Node(Blockchain&);
+    ~Node();
+
+    Node(const Node&) = delete;
+    auto operator=(const Node&) -> Node& = delete;
+
+    // serve the chain to peers at the given address
+    auto listen(const std::string&) -> bool;
+    auto stop() -> void;
+    auto get_address() const -> std::string;
+
+    // peers are announced to after every block mined through the node
+    auto add_peer(const std::string&) -> void;
+    auto mine(const std::string&) -> bool;
+    auto announce() -> size_t;
+
+    // catch up with the peer at the given address, returns the number of blocks imported
+    auto sync_from(const std::string&, const size_t& connections = 4) -> size_t;
+
+    private:
+        Blockchain& blockchain;
+        std::string address;
+        int listen_fd;
+        std::atomic<bool> running;
+        std::thread acceptor;
+
+        // connection handlers run detached, stop waits for all of them
+        std::mutex handlers_mutex;
+        std::condition_variable handlers_done;
+        std::vector<int> handler_fds;
+        size_t active_handlers;
+
+        std::mutex peers_mutex;
+        std::vector<std::string> peers;
+
+        // background sync started by an announcement
+        std::mutex sync_mutex;
+        std::thread background_sync;
+        std::atomic<bool> syncing;
+
+        auto accept_loop() -> void;
+        auto serve(const int) -> void;
+        auto announce_to(const std::string&) -> bool;
+        auto start_background_sync(const std::string&) -> void;
+
+};
+
+#endif // NODE_HEADER_FILE
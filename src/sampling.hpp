@@ -0,0 +1,25 @@
+#ifndef SAMPLING_HEADER_FILE
+#define SAMPLING_HEADER_FILE
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// workload helpers shared by the load generators and the benchmarks
+
+// deterministic pseudo random numbers (splitmix64), identical on every platform
+inline auto next_random(uint64_t& state) -> uint64_t {
+    uint64_t z{(state += 0x9e3779b97f4a7c15)};
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// nearest-rank percentile of sorted values (0 when there are none)
+inline auto percentile(const std::vector<double>& sorted, const double& p) -> double {
+    if (sorted.empty()) return 0.0;
+    const auto rank{static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999)};
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+#endif // SAMPLING_HEADER_FILE
@@ -1,19 +1,31 @@
 #include "sha256.hpp"
+#include "trace.hpp"
 
-SHA256::SHA256(const std::string& msg) {
+SHA256::SHA256(const std::string& msg) : message(msg), M(nullptr), size(0), bits(8) {
+}
+
+/* prepare
+
+  Purpose: build the preprocessed message (padded and parsed into 32-bit words)
+           the first time it is needed
+
+  Side effects: allocates and fills the hash data structure
+*/
+auto SHA256::prepare() const -> void {
+    if (this->M) return;
 
     // determine message length in bits (8 bits per char)
-    auto l{this->l_calc(msg.length())};
+    auto l{this->l_calc(this->message.length())};
     // determine number of '0's needed to pad the message
     auto k{this->k_calc(l-((l+1+64)/512)*512)};
     // determine number of 8 bit blocks needed to store the message (must be multiple of 512 bits)
-    auto N{msg.length()+1+(k-7)/8+8};
+    auto N{this->message.length()+1+(k-7)/8+8};
     // initialize data structure to hold message
     this->M = new uint64_t[N];
     this->size = N;
     this->bits = 8;
 
-    this->preprocess(msg, l, k);
+    this->preprocess(this->message, l);
 }
 
 SHA256::~SHA256() {
@@ -21,6 +33,7 @@ SHA256::~SHA256() {
 }
 
 auto SHA256::display_message(const size_t& end) const -> void {
+    this->prepare();
     std::cout << "\n";
     std::cout << std::setw(4) << "Block  "
               << std::setw(8) << "Int" << "   "
@@ -50,6 +63,7 @@ auto SHA256::display_block_in_hex(const uint32_t& char_block) const -> std::stri
 }
 
 auto SHA256::operator[](const size_t& index) -> uint64_t& {
+      this->prepare();
       return M[index];
 }
 
@@ -89,7 +103,7 @@ auto SHA256::k_calc(const size_t& l) const -> size_t {
   Side effects: stores bits representing the original message in the 
                 hash data structure
 */
-auto SHA256::msg_to_bits(const std::string& msg) -> size_t {
+auto SHA256::msg_to_bits(const std::string& msg) const -> size_t {
 
     // convert each ASCII character to its binary representation
     size_t i{0}; size_t len{msg.length()};
@@ -112,7 +126,7 @@ auto SHA256::msg_to_bits(const std::string& msg) -> size_t {
   Side effects: the binary representation of the message with padding is 
                 stored in the hash data structure
 */
-auto SHA256::pad(const size_t& current_index) -> size_t {
+auto SHA256::pad(const size_t& current_index) const -> size_t {
 
     auto i{current_index};
     auto l{this->l_calc(i-1)};     // determine message length in bits (8 bits per char)
@@ -142,7 +156,7 @@ auto SHA256::pad(const size_t& current_index) -> size_t {
   Side effects: the binary representation of the message with padding is 
                 stored in the hash data structure
 */
-auto SHA256::append_msg_length(const size_t& current_index, const size_t& l) -> size_t {
+auto SHA256::append_msg_length(const size_t& current_index, const size_t& l) const -> size_t {
 
     auto i{current_index};
     // append 64-bit block equal to the number l in binary to the end of the message
@@ -168,7 +182,7 @@ auto SHA256::append_msg_length(const size_t& current_index, const size_t& l) ->
   Side effects: the binary representation of the message with padding is 
                 stored in the hash data structure in 32 bit blocks
 */
-auto SHA256::parse_padded_msg_block() -> void {
+auto SHA256::parse_padded_msg_block() const -> void {
     // assign the data to each 32 bit block
     for (size_t i{0}; i < size; i +=4) {
         std::bitset<32> bitblock;
@@ -191,14 +205,14 @@ auto SHA256::parse_padded_msg_block() -> void {
 
   Parameters: msg, the message to preprocess
               l, length of the message in bits
-              k, number of '0's in the padded message
 
   Return: none
 
   Side effects: the binary representation of the message with padding is 
                 stored in the hash data structure
 */
-auto SHA256::preprocess(const std::string& msg, const size_t& l, const size_t& k) -> void {
+auto SHA256::preprocess(const std::string& msg, const size_t& l) const -> void {
+    TRACE_SPAN("SHA256::preprocess");
 
     // convert the msg to its binary representation and return the message length
     // the length is stored as the block_index
@@ -216,16 +230,6 @@ auto SHA256::preprocess(const std::string& msg, const size_t& l, const size_t& k
     // parse the padded message into 32-bit blocks
     parse_padded_msg_block();
 
-    // set initial hash value (Section 5.3.2)
-    this->H[0] = 0x6a09e667; // a <- H_1^(i-1) where i == 1
-    this->H[1] = 0xbb67ae85; // b <- H_2^(i-1)
-    this->H[2] = 0x3c6ef372; // c <- H_3^(i-1)
-    this->H[3] = 0xa54ff53a; // d <- H_4^(i-1)
-    this->H[4] = 0x510e527f; // e <- H_5^(i-1)
-    this->H[5] = 0x9b05688c; // f <- H_6^(i-1)
-    this->H[6] = 0x1f83d9ab; // g <- H_7^(i-1)
-    this->H[7] = 0x5be0cd19; // h <- H_8^(i-1)
-
     return;
 }
 
@@ -257,13 +261,122 @@ auto SHA256::sigma1(const uint32_t& x) const-> uint32_t {
     return this->rotr(x, 17) ^ this->rotr(x, 19) ^ (x >> 10);
 }
 
+namespace {
+
+    // the functions of Section 4.1.2 on values held in registers
+    inline auto big_sigma0(uint32_t x) -> uint32_t { return std::rotr(x, 2) ^ std::rotr(x, 13) ^ std::rotr(x, 22); }
+    inline auto big_sigma1(uint32_t x) -> uint32_t { return std::rotr(x, 6) ^ std::rotr(x, 11) ^ std::rotr(x, 25); }
+    inline auto small_sigma0(uint32_t x) -> uint32_t { return std::rotr(x, 7) ^ std::rotr(x, 18) ^ (x >> 3); }
+    inline auto small_sigma1(uint32_t x) -> uint32_t { return std::rotr(x, 17) ^ std::rotr(x, 19) ^ (x >> 10); }
+
+    // 32-bit big-endian word at p (compiles to a load and a byte swap)
+    inline auto load_be32(const unsigned char* p) -> uint32_t {
+        return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+    }
+
+    inline auto store_be64(unsigned char* p, uint64_t x) -> void {
+        for (size_t i{0}; i < 8; ++i) p[i] = static_cast<unsigned char>(x >> (56 - 8 * i));
+    }
+
+}
+
+/* compress
+
+  Purpose: process 512-bit blocks (Section 6.2.2), the working variables stay in
+           registers and the message schedule is computed on the fly in a 16 word
+           window (W[t] only depends on the previous 16 words), words are loaded
+           big-endian straight from the input bytes
+
+  Parameters: H, the intermediate hash value
+              blocks, the message blocks
+              nblocks, number of 64 byte blocks
+
+  Return: none
+
+  Side effects: H holds the intermediate hash value after the last block
+*/
+auto SHA256::compress(uint32_t (&H)[8], const unsigned char* blocks, const size_t& nblocks) -> void {
+    for (size_t i{0}; i < nblocks; ++i, blocks += 64) {
+        uint32_t W[16];
+        auto a{H[0]}, b{H[1]}, c{H[2]}, d{H[3]}, e{H[4]}, f{H[5]}, g{H[6]}, h{H[7]};
+
+        // uint32_t arithmetic wraps modulo 2^32, no masking needed
+        const auto round{[&](const size_t& t, const uint32_t& w) {
+            const auto T1{h + big_sigma1(e) + ((e & f) ^ (~e & g)) + K[t] + w};
+            const auto T2{big_sigma0(a) + ((a & (b | c)) | (b & c))};
+            h = g; g = f; f = e; e = d + T1;
+            d = c; c = b; b = a; a = T1 + T2;
+        }};
+        for (size_t t{0}; t < 16; ++t) {
+            W[t] = load_be32(blocks + 4 * t);
+            round(t, W[t]);
+        }
+        for (size_t t{16}; t < 64; ++t) {
+            auto& w{W[t & 15]};
+            w += small_sigma1(W[(t - 2) & 15]) + W[(t - 7) & 15] + small_sigma0(W[(t - 15) & 15]);
+            round(t, w);
+        }
+
+        H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+        H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+    }
+}
+
+/* digest
+
+  Purpose: hash a message, the whole blocks are compressed in place, only the
+           tail is copied into the padded final block(s) (Section 5.1.1)
+
+  Parameters: msg, the message
+
+  Return: the hash as 64 hex characters
+*/
+auto SHA256::digest(const std::string_view& msg) -> std::string {
+    TRACE_SPAN("SHA256::digest");
+    uint32_t H[8];
+    std::memcpy(H, initial, sizeof(H));
+
+    const auto data{reinterpret_cast<const unsigned char*>(msg.data())};
+    const auto whole{msg.size() / 64};
+    compress(H, data, whole);
+
+    // the tail, the "1" bit, the "0"s and the length in bits fill one or two blocks
+    unsigned char tail[128]{};
+    const auto rest{msg.size() - whole * 64};
+    if (rest) std::memcpy(tail, data + whole * 64, rest);
+    tail[rest] = 0x80;
+    const size_t ntail{(rest + 1 + 8 > 64) ? 2u : 1u};
+    store_be64(tail + ntail * 64 - 8, static_cast<uint64_t>(msg.size()) * 8);
+    compress(H, tail, ntail);
+
+    static constexpr char hex[]{"0123456789abcdef"};
+    std::string result(64, '0');
+    for (size_t i{0}; i < 64; ++i) result[i] = hex[(H[i / 8] >> (28 - 4 * (i % 8))) & 0xF];
+    return result;
+}
+
 /* compute_digest
 
   compute the message hash
+*/
+auto SHA256::compute_digest() -> std::string {
+    TRACE_SPAN("SHA256::compute_digest");
+    return digest(this->message);
+}
+
+/* compute_reference_digest
+
+  compute the message hash following the standard step by step over the
+  preprocessed message (the original implementation, kept as a reference)
 
   Note: anywhere 0xFFFFFFFF is used is to ensure 32-bit
 */
-auto SHA256::compute_digest() -> std::string {
+auto SHA256::compute_reference_digest() -> std::string {
+
+    this->prepare();
+
+    // set initial hash value (Section 5.3.2)
+    std::memcpy(this->H, initial, sizeof(this->H));
 
     auto N{size};
     size_t k{0}; // continuously count through M
@@ -474,3 +587,23 @@ TEST_CASE("Secure Hash Standard Test") {
     }
 #endif // ENABLE_LONG_TESTS
 }
+
+TEST_CASE("SHA-256 scalar core") {
+    SUBCASE("every length around the block boundaries matches the reference") {
+        std::string message;
+        for (size_t len{0}; len <= 200; ++len) {
+            SHA256 sha(message);
+            const auto digest{sha.compute_digest()};
+            CHECK(digest == sha.compute_reference_digest());
+            CHECK(digest == SHA256::digest(message));
+            message.push_back(static_cast<char>(len * 37 + 11));
+        }
+    }
+    SUBCASE("the preprocessed message is built on demand") {
+        SHA256 sha("abc");
+        CHECK(sha[0] == 0x61626380);
+        CHECK(sha[15] == 24);
+        CHECK(sha.compute_digest() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        CHECK(sha.compute_reference_digest() == sha.compute_digest());
+    }
+}
@@ -1,25 +1,33 @@
 #ifndef SHA256_HEADER_FILE
 #define SHA256_HEADER_FILE
 
+#include <bit>
 #include <bitset>
+#include <cstdint>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
-#if (UNITTEST)
-    #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
-#else
-    #define DOCTEST_CONFIG_DISABLE
-#endif
-#include "doctest.h"
+#include "unit_test.hpp"
 
+/* SHA256
+
+  Purpose: SHA-256 (FIPS 180-4), compute_digest and digest run the scalar core
+           straight over the message bytes, the step by step preprocessing of
+           the standard (padded message words, operator[], display_message) is
+           built on first use and drives compute_reference_digest
+*/
 struct SHA256 {   
     
     // methods
     SHA256(const std::string&);
     ~SHA256();
+
+    SHA256(const SHA256&) = delete;
+    auto operator=(const SHA256&) -> SHA256& = delete;
        
     // use to output message to terminal
     auto display_message(const size_t&) const -> void;
@@ -30,15 +38,26 @@ struct SHA256 {
     // display the block in hexidecimal
     auto display_block_in_hex(const uint32_t&) const -> std::string;
     
+    // word of the preprocessed message
     auto operator[](const size_t&) -> uint64_t&;
     
     // compute the message hash
     auto compute_digest() -> std::string;   
+
+    // compute the message hash over the preprocessed message, as laid out in the standard
+    auto compute_reference_digest() -> std::string;
+
+    // hash a message (without keeping a copy of it)
+    static auto digest(const std::string_view&) -> std::string;
+
+    // process the given number of 64 byte blocks into the intermediate hash value
+    static auto compress(uint32_t (&)[8], const unsigned char*, const size_t&) -> void;
     
     private:
-        uint64_t* M; // message data block
-        size_t size; // length of the message in bits bit blocks
-        size_t bits; // number of bits per block
+        const std::string message;
+        mutable uint64_t* M; // message data block (built on first use)
+        mutable size_t size; // length of the message in bits bit blocks
+        mutable size_t bits; // number of bits per block
 
         uint32_t H[8]; // SHA-256 hash values (store in hex)
         static constexpr uint32_t K[64] = {
@@ -59,8 +78,15 @@ struct SHA256 {
             0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
             0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
         };
+        static constexpr uint32_t initial[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
             
     protected:
+        // build the preprocessed message (once)
+        auto prepare() const -> void;
+
         // determine the size of the block array by determining how many 512 bit
         // blocks are required to hold the message with padding
         inline auto l_calc(const size_t&) const -> size_t;
@@ -69,19 +95,19 @@ struct SHA256 {
         inline auto k_calc(const size_t&) const -> size_t; 
         
         // convert the message (an ASCII string) to its bit representation
-        auto msg_to_bits(const std::string&) -> size_t;
+        auto msg_to_bits(const std::string&) const -> size_t;
         
         // pad the message to the next 512 bit block with '0's
-        auto pad(const size_t&) -> size_t;
+        auto pad(const size_t&) const -> size_t;
         
         // append message length in bits to the end of the message block
-        auto append_msg_length(const size_t&, const size_t&) -> size_t;
+        auto append_msg_length(const size_t&, const size_t&) const -> size_t;
         
         // parse the message from 8 bit blocks to 32 bit blocks
-        auto parse_padded_msg_block() -> void;
+        auto parse_padded_msg_block() const -> void;
         
         // preprocess the message
-        auto preprocess(const std::string&, const size_t&, const size_t&) -> void;
+        auto preprocess(const std::string&, const size_t&) const -> void;
         
         // logical functions in SHA-256
         inline auto rotr(const uint32_t&, const uint32_t&) const -> uint32_t;
@@ -0,0 +1,85 @@
+#include "sha256.hpp"
+#include "sha256_fixed.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+auto SHA256Fixed::to_hex(const Digest& H) -> std::string {
+    constexpr char hex[]{"0123456789abcdef"};
+    std::string out(64, '0');
+    for (size_t i{0}; i < 8; ++i) {
+        for (size_t j{0}; j < 8; ++j) out[8 * i + j] = hex[(H[i] >> (28 - 4 * j)) & 0xF];
+    }
+    return out;
+}
+
+/* digest
+
+  Purpose: hash a message, dispatching short messages (up to 4 blocks, 247 bytes)
+           to the fixed-size kernels and longer ones to the generic SHA256
+
+  Parameters: msg, the message to hash
+
+  Return: the SHA-256 digest as a hexadecimal string
+
+  Side effects: None
+*/
+auto SHA256Fixed::digest(const std::string& msg) -> std::string {
+    TRACE_SPAN("SHA256Fixed::digest");
+    switch (blocks_for(msg.size())) {
+        case 1: return to_hex(hash_fixed<1>(msg));
+        case 2: return to_hex(hash_fixed<2>(msg));
+        case 3: return to_hex(hash_fixed<3>(msg));
+        case 4: return to_hex(hash_fixed<4>(msg));
+        default: return SHA256::digest(msg);
+    }
+}
+
+auto SHA256Fixed::digest_batch(const std::vector<std::string>& msgs) -> std::vector<std::string> {
+    std::vector<std::string> digests(msgs.size());
+    ThreadPool::engine()->parallel_for(0, msgs.size(), 64, [&msgs, &digests](size_t first, size_t last) {
+        for (auto i{first}; i < last; ++i) digests[i] = digest(msgs[i]);
+    });
+    return digests;
+}
+
+/******************************************************************************
+ UNIT TESTING
+******************************************************************************/
+// compile time test vectors (FIPS 180-4 examples)
+static_assert(SHA256Fixed::equal(SHA256Fixed::hash("abc"), SHA256Fixed::Digest{
+    0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223, 0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad}));
+static_assert(SHA256Fixed::equal(SHA256Fixed::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), SHA256Fixed::Digest{
+    0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039, 0xa33ce459, 0x64ff2167, 0xf6ecedd4, 0x19db06c1}));
+static_assert(SHA256Fixed::equal(SHA256Fixed::hash_fixed<2>("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                                 SHA256Fixed::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")));
+static_assert(SHA256Fixed::equal(SHA256Fixed::hash_fixed<2>(std::string_view{"0123456789012345678901234567890123456789012345678901234567890123"}),
+                                 SHA256Fixed::hash(std::string_view{"0123456789012345678901234567890123456789012345678901234567890123"})));
+
+TEST_CASE("Fixed-size SHA-256 kernels") {
+    SUBCASE("batches match single digests") {
+        std::vector<std::string> msgs;
+        for (size_t i{0}; i < 500; ++i) msgs.push_back(std::string(i, 'x'));
+        const auto digests{SHA256Fixed::digest_batch(msgs)};
+        REQUIRE(digests.size() == msgs.size());
+        for (size_t i{0}; i < msgs.size(); ++i) CHECK(digests[i] == SHA256(msgs[i]).compute_digest());
+    }
+    SUBCASE("hex formatting") {
+        CHECK(SHA256Fixed::to_hex(SHA256Fixed::hash("abc")) ==
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        CHECK(SHA256Fixed::digest("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    }
+    SUBCASE("every length up to 5 blocks matches the generic implementation") {
+        // covers the 55/56 and 63/64 byte padding boundaries of each block count
+        std::string msg;
+        for (size_t len{0}; len <= 320; ++len) {
+            CHECK(SHA256Fixed::digest(msg) == SHA256(msg).compute_digest());
+            CHECK(SHA256Fixed::to_hex(SHA256Fixed::hash(msg)) == SHA256(msg).compute_digest());
+            msg.push_back(static_cast<char>('a' + len % 26));
+        }
+    }
+    SUBCASE("kernels fall back for messages of another block count") {
+        const std::string msg(100, 'x');
+        CHECK(SHA256Fixed::hash_fixed<1>(msg) == SHA256Fixed::hash(msg));
+        CHECK(SHA256Fixed::hash_fixed<3>(msg) == SHA256Fixed::hash(msg));
+    }
+}
@@ -0,0 +1,190 @@
+#ifndef SHA256_FIXED_HEADER_FILE
+#define SHA256_FIXED_HEADER_FILE
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "unit_test.hpp"
+
+/* SHA256Fixed
+
+  Purpose: constexpr capable SHA-256 (FIPS 180-4) for compile time constants and
+           test vectors, plus kernels specialized on the number of 512 bit blocks
+           with fully unrolled rounds (used by the miner for short preimages)
+*/
+struct SHA256Fixed {
+
+    using Digest = std::array<uint32_t, 8>;
+    using Schedule = std::array<uint32_t, 64>; // K[t] + W[t] for each round
+
+    // number of 512 bit blocks in the padded message
+    static constexpr auto blocks_for(const size_t& length) -> size_t {
+        return (length + 9 + 63) / 64;
+    }
+
+    // hash a message of any length (usable in constant expressions)
+    static constexpr auto hash(const std::string_view& msg) -> Digest {
+        auto H{initial};
+        const auto nblocks{blocks_for(msg.size())};
+        for (size_t b{0}; b < nblocks; ++b) {
+            std::array<uint8_t, 64> block{};
+            for (size_t i{0}; i < 64; ++i) block[i] = padded_byte(msg, 64 * b + i, nblocks);
+            compress(H, schedule(block.data()));
+        }
+        return H;
+    }
+
+    /* hash_fixed
+
+      Purpose: hash a message that pads to exactly NBlocks 512 bit blocks
+               (blocks_for(msg.size()) == NBlocks), messages of any other
+               length are handed to the generic hash
+
+      Note: when the last block holds nothing but padding, its (constant)
+            message schedule is taken from a table computed at compile time
+    */
+    template <size_t NBlocks>
+    static constexpr auto hash_fixed(const std::string_view& msg) -> Digest {
+        static_assert(NBlocks > 0, "a padded message has at least one block");
+        const auto len{msg.size()};
+        if (blocks_for(len) != NBlocks) return hash(msg);
+
+        std::array<uint8_t, 64 * NBlocks> buffer{};
+        for (size_t i{0}; i < len; ++i) buffer[i] = static_cast<uint8_t>(msg[i]);
+        buffer[len] = 0x80;
+        for (size_t i{0}; i < 8; ++i) buffer[64 * NBlocks - 1 - i] = static_cast<uint8_t>((uint64_t{8} * len) >> (8 * i));
+
+        auto H{initial};
+        if constexpr (NBlocks > 1) {
+            constexpr size_t tail_start{64 * (NBlocks - 1) - 8};
+            if (len <= 64 * (NBlocks - 1)) { // the last block is padding only
+                for (size_t b{0}; b + 1 < NBlocks; ++b) compress(H, schedule(buffer.data() + 64 * b));
+                compress(H, padding_tails<NBlocks>[len - tail_start]);
+                return H;
+            }
+        }
+        for (size_t b{0}; b < NBlocks; ++b) compress(H, schedule(buffer.data() + 64 * b));
+        return H;
+    }
+
+    // message schedule of a final block that holds only padding for a message of the given length
+    static constexpr auto padding_schedule(const size_t& length) -> Schedule {
+        std::array<uint8_t, 64> block{};
+        if (length % 64 == 0) block[0] = 0x80; // otherwise the 0x80 byte ends the previous block
+        for (size_t i{0}; i < 8; ++i) block[63 - i] = static_cast<uint8_t>((uint64_t{8} * length) >> (8 * i));
+        return schedule(block.data());
+    }
+
+    // compare digests (std::array comparison is not constexpr before C++20)
+    static constexpr auto equal(const Digest& x, const Digest& y) -> bool {
+        for (size_t i{0}; i < 8; ++i) if (x[i] != y[i]) return false;
+        return true;
+    }
+
+    // lowercase hexadecimal representation (matches SHA256::compute_digest)
+    static auto to_hex(const Digest&) -> std::string;
+
+    // hash with the fixed-size kernel for short messages (generic SHA256 otherwise)
+    static auto digest(const std::string&) -> std::string;
+
+    // hash many messages, in parallel on the engine thread pool
+    static auto digest_batch(const std::vector<std::string>&) -> std::vector<std::string>;
+
+    private:
+        static constexpr Digest initial{
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        static constexpr uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+            0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+            0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+            0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+            0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+            0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+            0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+            0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        // schedules of the padding-only final blocks of an NBlocks message,
+        // indexed by (message length - (64 * (NBlocks - 1) - 8))
+        template <size_t NBlocks>
+        static constexpr auto make_padding_tails() -> std::array<Schedule, 9> {
+            std::array<Schedule, 9> tails{};
+            for (size_t i{0}; i < 9; ++i) tails[i] = padding_schedule(64 * (NBlocks - 1) - 8 + i);
+            return tails;
+        }
+        template <size_t NBlocks>
+        static constexpr std::array<Schedule, 9> padding_tails{make_padding_tails<NBlocks>()};
+
+        // byte i of the padded message
+        static constexpr auto padded_byte(const std::string_view& msg, const size_t& i, const size_t& nblocks) -> uint8_t {
+            const auto len{msg.size()};
+            if (i < len) return static_cast<uint8_t>(msg[i]);
+            if (i == len) return 0x80;
+            const auto end{64 * nblocks};
+            if (i + 8 < end) return 0x00;
+            return static_cast<uint8_t>((uint64_t{8} * len) >> (8 * (end - 1 - i)));
+        }
+
+        static constexpr auto rotr(const uint32_t x, const uint32_t n) -> uint32_t {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        // expand a 64 byte block into the message schedule (with the round constants added)
+        static constexpr auto schedule(const uint8_t* block) -> Schedule {
+            Schedule W{};
+            for (size_t t{0}; t < 16; ++t) {
+                W[t] = static_cast<uint32_t>(block[4 * t]) << 24 | static_cast<uint32_t>(block[4 * t + 1]) << 16 |
+                       static_cast<uint32_t>(block[4 * t + 2]) << 8 | static_cast<uint32_t>(block[4 * t + 3]);
+            }
+            for (size_t t{16}; t < 64; ++t) {
+                const auto s0{rotr(W[t - 15], 7) ^ rotr(W[t - 15], 18) ^ (W[t - 15] >> 3)};
+                const auto s1{rotr(W[t - 2], 17) ^ rotr(W[t - 2], 19) ^ (W[t - 2] >> 10)};
+                W[t] = W[t - 16] + s0 + W[t - 7] + s1;
+            }
+            for (size_t t{0}; t < 64; ++t) W[t] += K[t];
+            return W;
+        }
+
+        // round T of the compression function, the working variables rotate by
+        // renaming (a is s[-T mod 8]) so no values are shuffled between rounds
+        template <size_t T>
+        static constexpr auto round(Digest& s, const Schedule& kw) -> void {
+            const auto a{s[(8 - T % 8) % 8]}, b{s[(9 - T % 8) % 8]}, c{s[(10 - T % 8) % 8]};
+            const auto e{s[(12 - T % 8) % 8]}, f{s[(13 - T % 8) % 8]}, g{s[(14 - T % 8) % 8]};
+            auto& d{s[(11 - T % 8) % 8]};
+            auto& h{s[(15 - T % 8) % 8]};
+            const auto T1{h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kw[T]};
+            const auto T2{(rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & (b | c)) | (b & c))};
+            d += T1;
+            h = T1 + T2;
+        }
+
+        template <size_t... T>
+        static constexpr auto rounds(Digest& s, const Schedule& kw, std::index_sequence<T...>) -> void {
+            (round<T>(s, kw), ...);
+        }
+
+        // compress one block into the intermediate hash value
+        static constexpr auto compress(Digest& H, const Schedule& kw) -> void {
+            auto s{H};
+            rounds(s, kw, std::make_index_sequence<64>{});
+            for (size_t i{0}; i < 8; ++i) H[i] += s[i];
+        }
+
+};
+
+#endif // SHA256_FIXED_HEADER_FILE
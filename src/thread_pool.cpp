@@ -0,0 +1,317 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "thread_pool.hpp"
+
+#ifndef ENGINE_POOL_THREADS
+#define ENGINE_POOL_THREADS 0 // every available CPU
+#endif
+
+#ifndef ENGINE_POOL_PLACEMENT
+#define ENGINE_POOL_PLACEMENT none
+#endif
+
+namespace {
+
+    // the pool and worker the current thread belongs to (if any)
+    thread_local const void* current_pool{nullptr};
+    thread_local size_t current_worker{0};
+
+    std::mutex engine_mutex;
+    std::shared_ptr<ThreadPool> engine_pool;
+
+    // a task of the engine pool may hold the last reference to it (a coroutine frame
+    // after a reconfigure), a worker can not join itself, so the pool is then
+    // destroyed on a thread of its own (the worker finishes its task meanwhile)
+    auto make_engine_pool(const size_t& threads, const ThreadPool::Placement& placement) -> std::shared_ptr<ThreadPool> {
+        return std::shared_ptr<ThreadPool>(new ThreadPool(threads, placement), [](ThreadPool* pool) {
+            if (current_pool == pool) std::thread([pool]() { delete pool; }).detach();
+            else delete pool;
+        });
+    }
+
+    // parse a kernel CPU list such as "0-3,8,10-11"
+    auto parse_cpulist(const std::string& list) -> std::vector<int> {
+        std::vector<int> cpus;
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            if (range.empty() || range == "\n") continue;
+            const auto dash{range.find('-')};
+            const int first{std::stoi(range.substr(0, dash))};
+            const int last{(dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1))};
+            for (int cpu{first}; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+}
+
+ThreadPool::ThreadPool(const size_t& threads, const Placement& nplacement) :
+    placement(nplacement), stopping(false), pending(0), next_queue(0), max_pending(0), executed(0), steals(0) {
+    const auto count{(threads == 0) ? std::max<size_t>(1, available_cpus().size()) : threads};
+    for (size_t i{0}; i < count; ++i) this->workers.push_back(std::make_unique<Worker>());
+    // start the workers once every deque exists (workers steal from each other)
+    for (size_t i{0}; i < count; ++i) {
+        this->workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+        this->pin(i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(this->idle_mutex);
+        this->stopping = true;
+    }
+    this->idle.notify_all();
+    for (auto& worker : this->workers) worker->thread.join();
+}
+
+/* post
+
+  Purpose: queue a task, on the calling worker's deque when called from a task
+           of this pool, round robin over the workers otherwise
+
+  Parameters: task, the task to run (it must not throw, use submit for tasks that may)
+*/
+auto ThreadPool::post(std::function<void()> task) -> void {
+    this->push(std::move(task), false);
+}
+
+// the owner runs its deque newest first, so a deferred task goes to the front
+auto ThreadPool::defer(std::function<void()> task) -> void {
+    this->push(std::move(task), true);
+}
+
+auto ThreadPool::push(std::function<void()> task, const bool& oldest) -> void {
+    const auto target{(current_pool == this) ? current_worker : this->next_queue++ % this->workers.size()};
+    size_t depth;
+    {
+        // counted before it is published, so a thief never takes an uncounted task
+        std::lock_guard lock(this->workers[target]->mutex);
+        auto& tasks{this->workers[target]->tasks};
+        depth = ++this->pending;
+        if (oldest) tasks.push_front(std::move(task));
+        else tasks.push_back(std::move(task));
+    }
+    for (auto high{this->max_pending.load()}; depth > high && !this->max_pending.compare_exchange_weak(high, depth);) {}
+    // lock so that a worker checking for work cannot miss the notification
+    std::lock_guard lock(this->idle_mutex);
+    this->idle.notify_one();
+}
+
+/* run_one
+
+  Purpose: run one task, the newest of the worker's own deque, or else the
+           oldest task of another worker
+
+  Parameters: self, the worker index
+
+  Return: true if a task was run,
+          false if every deque was empty
+*/
+auto ThreadPool::run_one(const size_t& self) -> bool {
+    std::function<void()> task;
+    const auto n{this->workers.size()};
+    for (size_t k{0}; k < n && !task; ++k) {
+        auto& victim{*this->workers[(self + k) % n]};
+        std::lock_guard lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        if (k == 0) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        } else {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            ++this->steals;
+        }
+    }
+    if (!task) return false;
+    --this->pending;
+    ++this->executed;
+    task();
+    return true;
+}
+
+auto ThreadPool::run(const size_t& self) -> void {
+    current_pool = this;
+    current_worker = self;
+    for (;;) {
+        if (this->run_one(self)) continue;
+        std::unique_lock lock(this->idle_mutex);
+        this->idle.wait(lock, [this]() { return this->stopping || this->pending > 0; });
+        if (this->stopping && this->pending == 0) return;
+    }
+}
+
+/* pin
+
+  Purpose: apply the CPU placement to a worker thread
+
+  Parameters: worker, the worker index
+
+  Side effects: the worker's CPU affinity is set (unless the placement is none)
+*/
+auto ThreadPool::pin(const size_t& worker) -> void {
+    std::vector<int> cpus;
+    if (this->placement == Placement::cores) {
+        const auto available{available_cpus()};
+        if (!available.empty()) cpus.push_back(available[worker % available.size()]);
+    } else if (this->placement == Placement::numa) {
+        const auto nodes{numa_nodes()};
+        if (!nodes.empty()) cpus = nodes[worker % nodes.size()];
+    }
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) CPU_SET(cpu, &set);
+    pthread_setaffinity_np(this->workers[worker]->thread.native_handle(), sizeof(set), &set);
+}
+
+auto ThreadPool::size() const -> size_t {
+    return this->workers.size();
+}
+
+auto ThreadPool::get_placement() const -> Placement {
+    return this->placement;
+}
+
+auto ThreadPool::get_stats() const -> Stats {
+    return {this->workers.size(), this->pending, this->max_pending, this->executed, this->steals};
+}
+
+auto ThreadPool::reset_stats() -> void {
+    this->max_pending = this->pending.load();
+    this->executed = 0;
+    this->steals = 0;
+}
+
+auto ThreadPool::engine() -> std::shared_ptr<ThreadPool> {
+    std::lock_guard lock(engine_mutex);
+    if (!engine_pool) engine_pool = make_engine_pool(ENGINE_POOL_THREADS, Placement::ENGINE_POOL_PLACEMENT);
+    return engine_pool;
+}
+
+auto ThreadPool::configure(const size_t& threads, const Placement& nplacement) -> void {
+    auto pool{make_engine_pool(threads, nplacement)};
+    std::lock_guard lock(engine_mutex);
+    engine_pool.swap(pool);
+    // the previous pool is destroyed by its last user (off the pool if that is one of its tasks)
+}
+
+auto ThreadPool::available_cpus() -> std::vector<int> {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu{0}; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        for (unsigned cpu{0}; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) cpus.push_back(static_cast<int>(cpu));
+    }
+    return cpus;
+}
+
+auto ThreadPool::numa_nodes() -> std::vector<std::vector<int>> {
+    const auto available{available_cpus()};
+    std::vector<std::vector<int>> nodes;
+    if (auto dir{opendir("/sys/devices/system/node")}) {
+        std::vector<int> ids;
+        while (auto entry{readdir(dir)}) {
+            const std::string name{entry->d_name};
+            if (name.rfind("node", 0) == 0 && name.size() > 4 && name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                ids.push_back(std::stoi(name.substr(4)));
+            }
+        }
+        closedir(dir);
+        std::sort(ids.begin(), ids.end());
+        for (const auto id : ids) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string line;
+            std::getline(list, line);
+            std::vector<int> cpus;
+            for (const auto cpu : parse_cpulist(line)) {
+                if (std::find(available.begin(), available.end(), cpu) != available.end()) cpus.push_back(cpu);
+            }
+            if (!cpus.empty()) nodes.push_back(cpus);
+        }
+    }
+    if (nodes.empty()) nodes.push_back(available); // no NUMA information, a single node
+    return nodes;
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Work-stealing thread pool") {
+
+    SUBCASE("tasks run and return results") {
+        ThreadPool pool(4);
+        std::vector<std::future<size_t>> results;
+        for (size_t i{0}; i < 100; ++i) results.push_back(pool.submit([i]() { return i * i; }));
+        size_t sum{0};
+        for (auto& result : results) sum += result.get();
+        CHECK(sum == 328350);
+        CHECK(pool.size() == 4);
+        CHECK_THROWS(pool.submit([]() -> int { throw std::runtime_error("task"); }).get());
+    }
+    SUBCASE("parallel_for covers every index once, also when nested") {
+        ThreadPool pool(3);
+        std::vector<std::atomic<int>> hits(10000);
+        pool.parallel_for(0, hits.size(), 64, [&](size_t first, size_t last) {
+            for (auto i{first}; i < last; ++i) ++hits[i];
+        });
+        CHECK(std::all_of(hits.begin(), hits.end(), [](const auto& h) { return h == 1; }));
+
+        std::atomic<size_t> inner{0};
+        pool.parallel_for(0, 8, 1, [&](size_t, size_t) {
+            pool.parallel_for(0, 100, 10, [&](size_t first, size_t last) { inner += last - first; });
+        });
+        CHECK(inner == 800);
+        CHECK_THROWS(pool.parallel_for(0, 10, 1, [](size_t first, size_t) {
+            if (first == 7) throw std::runtime_error("chunk");
+        }));
+    }
+    SUBCASE("idle workers steal queued tasks") {
+        ThreadPool pool(2);
+        std::atomic<bool> started{false}, release{false};
+        std::atomic<size_t> ran{0};
+        // the blocker keeps one worker busy, the tasks queued on that worker must be stolen
+        auto blocker{pool.submit([&]() {
+            started = true;
+            while (!release) std::this_thread::yield();
+        })};
+        while (!started) std::this_thread::yield();
+        std::vector<std::future<void>> rest;
+        for (size_t i{0}; i < 8; ++i) rest.push_back(pool.submit([&]() { ++ran; }));
+        for (auto& r : rest) r.get();
+        release = true;
+        blocker.get();
+        CHECK(ran == 8);
+        CHECK(pool.get_stats().executed == 9);
+        CHECK(pool.get_stats().queue_depth == 0);
+        CHECK(pool.get_stats().max_queue_depth >= 1);
+        CHECK(pool.get_stats().steals >= 1);
+    }
+    SUBCASE("placement and topology") {
+        CHECK(!ThreadPool::available_cpus().empty());
+        CHECK(!ThreadPool::numa_nodes().empty());
+        ThreadPool pinned(2, ThreadPool::Placement::numa);
+        CHECK(pinned.submit([]() { return 42; }).get() == 42);
+        CHECK(pinned.get_placement() == ThreadPool::Placement::numa);
+    }
+    SUBCASE("engine pool can be reconfigured") {
+        const auto before{ThreadPool::engine()};
+        ThreadPool::configure(3, ThreadPool::Placement::cores);
+        CHECK(ThreadPool::engine()->size() == 3);
+        CHECK(before->submit([]() { return 1; }).get() == 1); // still usable by its holders
+        ThreadPool::configure(0);
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef THREAD_POOL_HEADER_FILE
+#define THREAD_POOL_HEADER_FILE
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "unit_test.hpp"
+
+/* ThreadPool
+
+  Purpose: work-stealing task scheduler, every worker owns a deque (it runs its
+           own tasks newest first, idle workers steal the oldest tasks of others),
+           the engine shares one pool (ThreadPool::engine) between mining,
+           chain validation and batched hashing so they never oversubscribe cores
+
+  Note: tasks submitted from a worker go to that worker's deque, other threads
+        submit round robin, parallel_for callers take part in the loop so a
+        task may use parallel_for without deadlocking the pool
+*/
+struct ThreadPool {
+
+    // how workers are pinned to CPUs
+    enum class Placement {
+        none,  // left to the OS scheduler
+        cores, // worker i on the i-th available CPU
+        numa   // workers spread round robin over NUMA nodes, each pinned to its node's CPUs
+    };
+
+    struct Stats {
+        size_t threads;
+        size_t queue_depth;     // tasks currently queued
+        size_t max_queue_depth; // high water mark
+        size_t executed;        // tasks run
+        size_t steals;          // tasks run by a worker other than the one they were queued on
+    };
+
+    // threads 0 uses every CPU available to the process (respecting its affinity mask)
+    explicit ThreadPool(const size_t& threads = 0, const Placement& = Placement::none);
+    ~ThreadPool(); // runs the queued tasks, then joins the workers
+
+    ThreadPool(const ThreadPool&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    auto post(std::function<void()>) -> void;
+    // queue a task behind the tasks already queued on the calling worker (used to yield)
+    auto defer(std::function<void()>) -> void;
+
+    // run a callable on the pool, the future holds its result (or exception)
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+        auto task{std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f))};
+        auto result{task->get_future()};
+        this->post([task]() { (*task)(); });
+        return result;
+    }
+
+    /* parallel_for
+
+      Purpose: call body(chunk_begin, chunk_end) over [begin, end) split into chunks
+               of grain items, chunks are claimed in increasing order, the caller
+               runs chunks too and returns once every chunk has finished
+
+      Note: the first exception thrown by the body is rethrown to the caller
+    */
+    template <typename F>
+    auto parallel_for(const size_t& begin, const size_t& end, const size_t& grain, F&& body) -> void {
+        if (begin >= end) return;
+        const auto step{std::max<size_t>(1, grain)};
+        const auto chunks{(end - begin + step - 1) / step};
+        if (chunks == 1 || this->workers.size() < 2) {
+            body(begin, end);
+            return;
+        }
+
+        struct Loop {
+            std::atomic<size_t> next{0}, done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+        };
+        auto loop{std::make_shared<Loop>()};
+        auto run{[loop, begin, end, step, chunks, body]() {
+            for (size_t c{loop->next++}; c < chunks; c = loop->next++) {
+                try {
+                    body(begin + c * step, std::min(end, begin + (c + 1) * step));
+                } catch (...) {
+                    std::lock_guard lock(loop->mutex);
+                    if (!loop->error) loop->error = std::current_exception();
+                }
+                if (++loop->done == chunks) {
+                    std::lock_guard lock(loop->mutex);
+                    loop->finished.notify_all();
+                }
+            }
+        }};
+        const auto helpers{std::min(chunks, this->workers.size()) - 1};
+        for (size_t h{0}; h < helpers; ++h) this->post(run);
+        run();
+        std::unique_lock lock(loop->mutex);
+        loop->finished.wait(lock, [&loop, chunks]() { return loop->done == chunks; });
+        if (loop->error) std::rethrow_exception(loop->error);
+    }
+
+    auto size() const -> size_t;
+    auto get_placement() const -> Placement;
+    auto get_stats() const -> Stats;
+    auto reset_stats() -> void;
+
+    // the engine-wide pool (created on first use)
+    static auto engine() -> std::shared_ptr<ThreadPool>;
+    // replace the engine-wide pool, work already running finishes on the old pool
+    static auto configure(const size_t& threads, const Placement& = Placement::none) -> void;
+
+    // CPUs the process may run on, and the (available) CPUs of each NUMA node
+    static auto available_cpus() -> std::vector<int>;
+    static auto numa_nodes() -> std::vector<std::vector<int>>;
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        const Placement placement;
+        std::mutex idle_mutex;
+        std::condition_variable idle;
+        std::atomic<bool> stopping;
+        std::atomic<size_t> pending, next_queue;
+        std::atomic<size_t> max_pending, executed, steals;
+
+        auto run(const size_t&) -> void;
+        auto run_one(const size_t&) -> bool;
+        auto pin(const size_t&) -> void;
+        auto push(std::function<void()>, const bool&) -> void;
+
+};
+
+#endif // THREAD_POOL_HEADER_FILE
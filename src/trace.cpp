@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace.hpp"
+
+namespace {
+
+    // fields are atomic so that a dump may read a span while its thread overwrites it
+    struct Span {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> duration;
+    };
+
+    /* Buffer
+
+      Purpose: ring buffer of the spans of one thread, span number s is kept in
+               slot s % capacity until span s + capacity overwrites it
+
+      Note: the owning thread is the only writer, head is the number of spans
+            recorded, floor the first span not cleared
+    */
+    struct Buffer {
+        explicit Buffer(const size_t& id) : tid(id), spans(std::make_unique<Span[]>(Trace::capacity)) {}
+        const size_t tid; // thread id in the trace
+        std::unique_ptr<Span[]> spans;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> floor{0};
+        std::atomic<bool> owned{true}; // a live thread records into the buffer
+    };
+
+    const uint64_t epoch{Trace::now()}; // trace timestamps are relative to the process start
+
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers; // never shrinks, so buffer pointers stay valid
+    std::set<std::string> names;
+
+    // the buffer of a thread is handed to a later thread once the thread exits
+    auto acquire_buffer() -> Buffer* {
+        std::lock_guard lock(registry_mutex);
+        for (auto& buffer : buffers) {
+            bool free{false};
+            if (buffer->owned.compare_exchange_strong(free, true)) return buffer.get();
+        }
+        buffers.push_back(std::make_unique<Buffer>(buffers.size() + 1));
+        return buffers.back().get();
+    }
+
+    struct ThreadBuffer {
+        Buffer* buffer{nullptr};
+        ~ThreadBuffer() {
+            if (this->buffer) this->buffer->owned = false;
+        }
+    };
+    thread_local ThreadBuffer thread_buffer;
+
+    // JSON string (the quotes and control characters of interned names are escaped)
+    auto append_escaped(std::string& out, const char* text) -> void {
+        out += '"';
+        for (auto c{text}; *c; ++c) {
+            const auto byte{static_cast<unsigned char>(*c)};
+            if (byte == '"' || byte == '\\') {
+                out += '\\';
+                out += *c;
+            } else if (byte < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+                out += escaped;
+            } else {
+                out += *c;
+            }
+        }
+        out += '"';
+    }
+
+}
+
+/* record
+
+  Purpose: add a span to the ring buffer of the calling thread
+
+  Parameters: name, the span name (must outlive the trace)
+              start, end, the span times (Trace::now)
+
+  Note: the release fence orders the publication of the previous span before
+        the overwrite of a slot, so a dump that reads an overwritten slot also
+        sees a head that marks the span in it as overwritten
+*/
+auto Trace::record(const char* name, const uint64_t& start, const uint64_t& end) -> void {
+    if (!Trace::is_recording()) return;
+    auto& buffer{thread_buffer.buffer};
+    if (!buffer) buffer = acquire_buffer();
+    const auto head{buffer->head.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_release);
+    auto& span{buffer->spans[head & (Trace::capacity - 1)]};
+    span.name.store(name, std::memory_order_relaxed);
+    span.start.store(start, std::memory_order_relaxed);
+    span.duration.store(end - start, std::memory_order_relaxed);
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+auto Trace::intern(const std::string& name) -> const char* {
+    std::lock_guard lock(registry_mutex);
+    return names.insert(name).first->c_str();
+}
+
+auto Trace::set_recording(const bool& on) -> void {
+    recording = on;
+}
+
+/* dump
+
+  Purpose: export the recorded spans in the Chrome trace-event format, one
+           complete ("X") event per span, timestamps in microseconds since
+           the process started
+
+  Return: the trace as a JSON object
+
+  Note: spans a thread overwrites while they are read are left out
+*/
+auto Trace::dump() -> std::string {
+    std::string out{"{\"traceEvents\":["};
+    const auto pid{std::to_string(getpid())};
+    bool first{true};
+    std::lock_guard lock(registry_mutex);
+    for (const auto& buffer : buffers) {
+        const auto head{buffer->head.load(std::memory_order_acquire)};
+        const auto oldest{std::max(buffer->floor.load(), (head > Trace::capacity) ? head - Trace::capacity : 0)};
+        struct Copy {
+            const char* name;
+            uint64_t start, duration;
+        };
+        std::vector<Copy> copies;
+        copies.reserve(head - std::min(head, oldest));
+        for (auto s{oldest}; s < head; ++s) {
+            const auto& span{buffer->spans[s & (Trace::capacity - 1)]};
+            copies.push_back({span.name.load(std::memory_order_relaxed), span.start.load(std::memory_order_relaxed),
+                              span.duration.load(std::memory_order_relaxed)});
+        }
+        // spans the thread may have overwritten in the meantime
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto now_head{buffer->head.load(std::memory_order_relaxed)};
+        const auto valid{(now_head >= Trace::capacity) ? now_head - Trace::capacity + 1 : 0};
+        for (size_t i{(valid > oldest) ? static_cast<size_t>(valid - oldest) : 0}; i < copies.size(); ++i) {
+            const auto& span{copies[i]};
+            char times[96];
+            std::snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f}",
+                          static_cast<double>(span.start - std::min(span.start, epoch)) / 1e3, static_cast<double>(span.duration) / 1e3);
+            out += first ? "\n" : ",\n";
+            first = false;
+            out += "{\"name\":";
+            append_escaped(out, span.name);
+            out += ",\"cat\":\"blockchain\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + std::to_string(buffer->tid);
+            out += times;
+        }
+    }
+    out += "\n],\"displayTimeUnit\":\"ns\"}";
+    return out;
+}
+
+auto Trace::clear() -> void {
+    std::lock_guard lock(registry_mutex);
+    for (auto& buffer : buffers) buffer->floor = buffer->head.load();
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Trace spans") {
+    const auto count{[](const std::string& trace, const std::string& text) {
+        size_t n{0};
+        for (auto pos{trace.find(text)}; pos != std::string::npos; pos = trace.find(text, pos + 1)) ++n;
+        return n;
+    }};
+
+    SUBCASE("spans of every thread are dumped as trace events") {
+        Trace::clear();
+        {
+            const TraceSpan outer("test outer");
+            const TraceSpan inner("test inner");
+        }
+        std::thread([]() { const TraceSpan span("test other thread"); }).join();
+        const auto trace{Trace::dump()};
+        CHECK(trace.rfind("{\"traceEvents\":[", 0) == 0);
+        CHECK(trace.find("],\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+        CHECK(count(trace, "\"name\":\"test outer\",\"cat\":\"blockchain\",\"ph\":\"X\"") == 1);
+        CHECK(count(trace, "\"name\":\"test inner\"") == 1);
+        CHECK(count(trace, "\"name\":\"test other thread\"") == 1);
+        // the inner span is recorded first and lies within the outer one
+        CHECK(trace.find("test inner") < trace.find("test outer"));
+        const auto tid_of{[&trace](const std::string& name) {
+            const auto at{trace.find("\"tid\":", trace.find(name))};
+            return trace.substr(at, trace.find(',', at) - at);
+        }};
+        CHECK(tid_of("test outer") == tid_of("test inner"));
+        CHECK(tid_of("test outer") != tid_of("test other thread"));
+        Trace::clear();
+        CHECK(count(Trace::dump(), "\"ph\":\"X\"") == 0);
+    }
+    SUBCASE("a full buffer keeps the newest spans") {
+        Trace::clear();
+        const auto first{Trace::intern("test wrapped \"first\"")};
+        const auto last{Trace::intern("test wrapped last")};
+        CHECK(Trace::intern("test wrapped last") == last);
+        for (size_t i{0}; i < Trace::capacity; ++i) Trace::record(first, 1000, 2000);
+        for (size_t i{0}; i < 10; ++i) Trace::record(last, 3000, 4000);
+        const auto trace{Trace::dump()};
+        CHECK(count(trace, "\"name\":\"test wrapped last\"") == 10);
+        CHECK(count(trace, "\"name\":\"test wrapped \\\"first\\\"\"") == Trace::capacity - 11);
+        Trace::clear();
+    }
+    SUBCASE("paused recording and concurrent dumps") {
+        Trace::clear();
+        Trace::set_recording(false);
+        { const TraceSpan span("test paused"); }
+        Trace::set_recording(true);
+        CHECK(count(Trace::dump(), "test paused") == 0);
+        std::atomic<bool> stop{false};
+        std::thread writer([&stop]() {
+            while (!stop) { const TraceSpan span("test concurrent"); }
+        });
+        size_t malformed{0};
+        for (size_t d{0}; d < 20; ++d) {
+            const auto trace{Trace::dump()};
+            malformed += count(trace, "{\"name\":") != count(trace, "\"ph\":\"X\"");
+            malformed += count(trace, "\"name\":\"test concurrent\"") > Trace::capacity;
+        }
+        stop = true;
+        writer.join();
+        CHECK(malformed == 0);
+        Trace::clear();
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef UNIT_TEST_HEADER_FILE
+#define UNIT_TEST_HEADER_FILE
+
+// unit tests are written with doctest next to the code under test, they are only
+// compiled in when UNITTEST is defined (the test target supplies the doctest main)
+#if !(UNITTEST)
+    #define DOCTEST_CONFIG_DISABLE
+#endif
+#include "doctest.h"
+
+#endif // UNIT_TEST_HEADER_FILE
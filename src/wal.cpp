@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "wal.hpp"
+#include "wire.hpp"
+
+namespace {
+
+    // CRC-32 (IEEE 802.3, reflected) lookup table
+    constexpr auto make_crc_table() -> std::array<uint32_t, 256> {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i{0}; i < 256; ++i) {
+            auto c{i};
+            for (size_t k{0}; k < 8; ++k) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return table;
+    }
+    constexpr auto crc_table{make_crc_table()};
+
+    auto crc32(const std::string& bytes) -> uint32_t {
+        uint32_t c{0xFFFFFFFF};
+        for (const auto byte : bytes) c = crc_table[(c ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFF;
+    }
+
+    constexpr size_t frame_header{8};           // length and CRC-32
+    constexpr uint32_t max_record{uint32_t{1} << 30};
+
+    auto system_error(const std::string& what) -> std::runtime_error {
+        return std::runtime_error("wal: " + what + ": " + std::strerror(errno));
+    }
+
+    // read exactly size bytes at offset (false at the end of the file)
+    auto read_at(const int& fd, char* out, const size_t& size, uint64_t offset) -> bool {
+        size_t done{0};
+        while (done < size) {
+            const auto n{pread(fd, out + done, size - done, static_cast<off_t>(offset + done))};
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw system_error("read");
+            if (n == 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /* scan
+
+      Purpose: walk the records of a log file up to the first torn or corrupt one
+
+      Parameters: fd, the log file
+                  limit, bytes of the file to look at
+                  apply, called on every valid record (may be empty)
+
+      Return: the size of the valid prefix and the number of records in it
+    */
+    auto scan(const int& fd, const uint64_t& limit, const std::function<void(const std::string&)>& apply)
+        -> std::pair<uint64_t, uint64_t> {
+        uint64_t offset{0}, records{0};
+        std::string header(frame_header, '\0'), payload;
+        while (offset + frame_header <= limit && read_at(fd, header.data(), frame_header, offset)) {
+            size_t pos{0};
+            const auto length{get_u32(header, pos)};
+            const auto crc{get_u32(header, pos)};
+            if (length > max_record || offset + frame_header + length > limit) break;
+            payload.resize(length);
+            if (!read_at(fd, payload.data(), length, offset + frame_header) || crc32(payload) != crc) break;
+            if (apply) apply(payload);
+            offset += frame_header + length;
+            ++records;
+        }
+        return {offset, records};
+    }
+
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& npath, const std::chrono::microseconds& nwindow) :
+    path(npath), window(nwindow), fd(-1), recovered_bytes(0), pending_sync(false),
+    appended(0), written(0), synced(0), sync_requested(0), stopping(false), stats{0, 0, 0, 0} {
+
+    const auto created{!std::filesystem::exists(this->path)};
+    this->fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd < 0) throw system_error("open " + this->path);
+
+    struct stat st;
+    if (fstat(this->fd, &st) != 0) {
+        close(this->fd);
+        throw system_error("stat " + this->path);
+    }
+    // keep the valid records, cut off what a crash left half written
+    const auto [valid, records]{scan(this->fd, static_cast<uint64_t>(st.st_size), {})};
+    this->recovered_bytes = valid;
+    this->appended = this->written = this->synced = this->sync_requested = records;
+    if ((valid < static_cast<uint64_t>(st.st_size) && ftruncate(this->fd, static_cast<off_t>(valid)) != 0) ||
+        lseek(this->fd, static_cast<off_t>(valid), SEEK_SET) < 0 || fdatasync(this->fd) != 0) {
+        close(this->fd);
+        throw system_error("recover " + this->path);
+    }
+    if (created) { // the directory entry of a new log must be durable too
+        const auto dir{std::filesystem::absolute(this->path).parent_path()};
+        const auto dfd{open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (dfd >= 0) {
+            fsync(dfd);
+            close(dfd);
+        }
+    }
+
+    this->flusher = std::thread([this]() { this->run(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->sync_requested = this->appended;
+        this->stopping = true;
+    }
+    this->wake.notify_one();
+    this->flusher.join();
+    close(this->fd);
+}
+
+/* append
+
+  Purpose: log a record
+
+  Parameters: record, the record (less than 1 GiB)
+              durability, none and async return at once, sync waits for the
+                          group commit that makes the record durable
+
+  Return: the sequence number of the record (see wait)
+
+  Side effects: throws std::length_error for oversized records,
+                std::runtime_error if the log has failed
+*/
+auto WriteAheadLog::append(const std::string& record, const Durability& durability) -> uint64_t {
+    if (record.size() >= max_record) throw std::length_error("wal: record too large");
+    std::string header;
+    put_u32(header, static_cast<uint32_t>(record.size()));
+    put_u32(header, crc32(record));
+
+    std::unique_lock lock(this->mutex);
+    this->check();
+    this->pending += header;
+    this->pending += record;
+    const auto sequence{++this->appended};
+    ++this->stats.appends;
+    this->stats.bytes += header.size() + record.size();
+    if (durability != Durability::none) this->pending_sync = true;
+    this->wake.notify_one();
+    if (durability == Durability::sync) {
+        this->durable.wait(lock, [this, sequence]() { return this->synced >= sequence || !this->error.empty(); });
+        this->check();
+    }
+    return sequence;
+}
+
+auto WriteAheadLog::wait(const uint64_t& sequence) -> void {
+    std::unique_lock lock(this->mutex);
+    this->check();
+    if (this->synced >= sequence) return;
+    this->sync_requested = std::max(this->sync_requested, sequence);
+    this->wake.notify_one();
+    this->durable.wait(lock, [this, sequence]() { return this->synced >= sequence || !this->error.empty(); });
+    this->check();
+}
+
+auto WriteAheadLog::sync() -> void {
+    uint64_t last;
+    {
+        std::lock_guard lock(this->mutex);
+        last = this->appended;
+    }
+    this->wait(last);
+}
+
+auto WriteAheadLog::replay(const std::function<void(const std::string&)>& apply) const -> size_t {
+    return scan(this->fd, this->recovered_bytes, apply).second;
+}
+
+auto WriteAheadLog::get_path() const -> const std::string& {
+    return this->path;
+}
+
+auto WriteAheadLog::get_records() const -> uint64_t {
+    std::lock_guard lock(this->mutex);
+    return this->appended;
+}
+
+auto WriteAheadLog::get_stats() const -> Stats {
+    std::lock_guard lock(this->mutex);
+    return this->stats;
+}
+
+auto WriteAheadLog::check() const -> void {
+    if (!this->error.empty()) throw std::runtime_error(this->error);
+}
+
+/* run
+
+  Purpose: the flusher, commits the pending records as a group: once a record is
+           pending it waits (at most) the commit window for more appends, then
+           writes them all at once and syncs them if any of them asked for it
+
+  Side effects: on a write or sync error the log fails (see check) and the flusher stops
+*/
+auto WriteAheadLog::run() -> void {
+    std::unique_lock lock(this->mutex);
+    for (;;) {
+        this->wake.wait(lock, [this]() {
+            return this->stopping || !this->pending.empty() || this->sync_requested > this->synced;
+        });
+        if (this->pending.empty() && this->sync_requested <= this->synced) break; // stopping, nothing left
+
+        // group commit: let concurrent appenders join this commit
+        if (this->window.count() > 0 && !this->stopping) {
+            this->wake.wait_for(lock, this->window, [this]() { return this->stopping; });
+        }
+        std::string batch;
+        batch.swap(this->pending);
+        const auto last{this->appended};
+        const auto need_sync{this->pending_sync || this->sync_requested > this->synced};
+        this->pending_sync = false;
+        lock.unlock();
+
+        std::string failure;
+        for (size_t done{0}; done < batch.size() && failure.empty();) {
+            const auto n{write(this->fd, batch.data() + done, batch.size() - done)};
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) failure = std::string{"wal: write: "} + std::strerror(errno);
+            else done += static_cast<size_t>(n);
+        }
+        if (failure.empty() && need_sync && fdatasync(this->fd) != 0) failure = std::string{"wal: sync: "} + std::strerror(errno);
+
+        lock.lock();
+        if (!failure.empty()) {
+            this->error = failure;
+            this->durable.notify_all();
+            break;
+        }
+        this->written = last;
+        if (!batch.empty()) ++this->stats.commits;
+        if (need_sync) {
+            this->synced = last;
+            ++this->stats.syncs;
+        }
+        this->durable.notify_all();
+    }
+}
+
+/******************************************************************************
+ UNIT TESTING WITH DOCTEST
+******************************************************************************/
+TEST_CASE("Write-ahead log") {
+    const auto path{"/tmp/blockchain_wal_test_" + std::to_string(getpid())};
+    const auto read_all{[&path]() {
+        WriteAheadLog log(path);
+        std::vector<std::string> records;
+        log.replay([&records](const std::string& record) { records.push_back(record); });
+        return records;
+    }};
+    const auto record{[](const size_t& i) { return "record " + std::to_string(i) + std::string(i % 7, '.'); }};
+
+    SUBCASE("records survive reopening the log") {
+        std::filesystem::remove(path);
+        {
+            WriteAheadLog log(path);
+            CHECK(log.append(record(1), Durability::sync) == 1);
+            CHECK(log.append(record(2), Durability::async) == 2);
+            CHECK(log.append(record(3), Durability::none) == 3);
+        }
+        const auto records{read_all()};
+        CHECK(records == std::vector<std::string>{record(1), record(2), record(3)});
+        WriteAheadLog log(path);
+        CHECK(log.get_records() == 3);
+        CHECK(log.append(record(4), Durability::sync) == 4);
+    }
+    SUBCASE("a torn or corrupt tail is cut off") {
+        std::filesystem::remove(path);
+        {
+            WriteAheadLog log(path);
+            for (size_t i{1}; i <= 5; ++i) log.append(record(i), Durability::none);
+        }
+        const auto size{std::filesystem::file_size(path)};
+        const auto last{8 + record(5).size()};
+        // a crash may stop the last write anywhere
+        for (size_t cut{1}; cut <= last; ++cut) {
+            std::filesystem::resize_file(path, size - cut);
+            const auto records{read_all()};
+            CHECK(records.size() == 4);
+            CHECK(std::filesystem::file_size(path) == size - last);
+            WriteAheadLog log(path);
+            log.append(record(5), Durability::sync);
+        }
+        // a flipped bit ends the log at the damaged record
+        const auto fd{open(path.c_str(), O_RDWR)};
+        [[maybe_unused]] const char garbage{'#'};
+        CHECK(pwrite(fd, &garbage, 1, 8 + static_cast<off_t>(record(1).size()) + 8 + 3) == 1);
+        close(fd);
+        CHECK(read_all() == std::vector<std::string>{record(1)});
+    }
+    SUBCASE("concurrent appends share syncs") {
+        std::filesystem::remove(path);
+        WriteAheadLog log(path, std::chrono::microseconds{2000});
+        std::vector<std::thread> threads;
+        for (size_t t{0}; t < 8; ++t) {
+            threads.emplace_back([&log, &record, t]() {
+                for (size_t i{0}; i < 25; ++i) log.append(record(100 * t + i), Durability::sync);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        [[maybe_unused]] const auto stats{log.get_stats()};
+        CHECK(stats.appends == 200);
+        CHECK(stats.syncs < stats.appends);
+        CHECK(stats.syncs == stats.commits);
+    }
+    SUBCASE("records that do not ask for durability are not synced for themselves") {
+        std::filesystem::remove(path);
+        WriteAheadLog log(path);
+        for (size_t i{0}; i < 10; ++i) log.append(record(i), Durability::none);
+        while (log.get_stats().commits == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(log.get_stats().syncs == 0);
+        log.sync();
+        CHECK(log.get_stats().syncs == 1);
+        log.wait(5); // already durable
+        CHECK(log.get_stats().syncs == 1);
+    }
+    SUBCASE("acknowledged records survive a crash") {
+        std::filesystem::remove(path);
+        // a child process appends and syncs groups of three records, acknowledging
+        // every group to the parent, which kills it at some point, the frames are
+        // built before the fork so the child only makes system calls (the parent
+        // may have threads holding locks)
+        std::vector<std::string> groups(200);
+        for (size_t i{1}; i <= 3 * groups.size(); ++i) {
+            auto& group{groups[(i - 1) / 3]};
+            put_u32(group, static_cast<uint32_t>(record(i).size()));
+            put_u32(group, crc32(record(i)));
+            group += record(i);
+        }
+        int acks[2];
+        REQUIRE(pipe(acks) == 0);
+        const auto child{fork()};
+        REQUIRE(child >= 0);
+        if (child == 0) {
+            close(acks[0]);
+            const auto fd{open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)};
+            if (fd < 0) _exit(1);
+            for (const auto& group : groups) {
+                for (size_t done{0}; done < group.size();) {
+                    const auto n{write(fd, group.data() + done, group.size() - done)};
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) _exit(1);
+                    done += static_cast<size_t>(n);
+                }
+                if (fdatasync(fd) != 0 || write(acks[1], "+", 1) != 1) _exit(1);
+            }
+            _exit(0);
+        }
+        close(acks[1]);
+        size_t acknowledged{0};
+        char ack;
+        while (acknowledged < 40 && read(acks[0], &ack, 1) == 1) ++acknowledged;
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        close(acks[0]);
+        CHECK(acknowledged == 40);
+        const auto records{read_all()};
+        REQUIRE(records.size() >= 3 * acknowledged);
+        for (size_t i{0}; i < records.size(); ++i) CHECK(records[i] == record(i + 1));
+        // the recovered log takes appends after the last complete record
+        {
+            WriteAheadLog log(path);
+            log.append("after the crash", Durability::sync);
+        }
+        CHECK(read_all().back() == "after the crash");
+    }
+    std::filesystem::remove(path);
+}
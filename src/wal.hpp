@@ -0,0 +1,89 @@
+#ifndef WAL_HEADER_FILE
+#define WAL_HEADER_FILE
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "unit_test.hpp"
+
+// how long an appender waits for its record to reach the disk
+enum class Durability {
+    none,  // written by the next group commit, never synced for its own sake
+    async, // synced by the next group commit, the append does not wait for it
+    sync   // the append returns once a group commit has synced it
+};
+
+/* WriteAheadLog
+
+  Purpose: append-only log of records made durable by group commit, a flusher
+           thread writes every record appended since its last commit with one
+           write and (if any of them asked for it) one fdatasync, records appended
+           while a commit is in progress go to the next one, so concurrent
+           appenders share the cost of a sync (a commit window can delay each
+           commit to gather more records, at the cost of latency)
+
+  Note: records are framed as length (u32), CRC-32 (u32) and payload, opening a
+        log cuts off a torn or corrupt tail (left by a crash) so that appends
+        continue after the last valid record
+
+        errors of the flusher (e.g. a full disk) are rethrown as std::runtime_error
+        by every later append, wait or sync
+*/
+struct WriteAheadLog {
+
+    struct Stats {
+        size_t appends;
+        size_t bytes;
+        size_t commits; // group writes
+        size_t syncs;   // fdatasync calls
+    };
+
+    // open (or create) the log, window is how long a commit waits for more appends
+    explicit WriteAheadLog(const std::string&, const std::chrono::microseconds& window = std::chrono::microseconds{0});
+    ~WriteAheadLog(); // commits and syncs what was appended, then stops the flusher
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    auto operator=(const WriteAheadLog&) -> WriteAheadLog& = delete;
+
+    // log a record, returns its sequence number (records are numbered from 1)
+    auto append(const std::string&, const Durability&) -> uint64_t;
+    // wait until the record with the given sequence number is durable
+    auto wait(const uint64_t&) -> void;
+    // make every appended record durable
+    auto sync() -> void;
+
+    // call apply on every record found when the log was opened (in order)
+    auto replay(const std::function<void(const std::string&)>&) const -> size_t;
+
+    auto get_path() const -> const std::string&;
+    auto get_records() const -> uint64_t; // records found on open plus records appended
+    auto get_stats() const -> Stats;
+
+    private:
+        const std::string path;
+        const std::chrono::microseconds window;
+        int fd;
+        uint64_t recovered_bytes; // valid prefix of the file when it was opened
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;    // the flusher waits for records
+        std::condition_variable durable; // appenders wait for commits
+        std::string pending;             // framed records not yet written
+        bool pending_sync;               // a pending record asked for a sync
+        uint64_t appended, written, synced, sync_requested;
+        bool stopping;
+        std::string error;
+        Stats stats;
+        std::thread flusher;
+
+        auto run() -> void;
+        auto check() const -> void; // throws the flusher error (mutex held)
+
+};
+
+#endif // WAL_HEADER_FILE
@@ -0,0 +1,83 @@
+#ifndef WIRE_HEADER_FILE
+#define WIRE_HEADER_FILE
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// little-endian encoding helpers shared by block serialization and the node protocol,
+// readers advance pos and throw std::runtime_error on truncated input
+
+inline auto put_u32(std::string& out, const uint32_t& value) -> void {
+    for (size_t i{0}; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+inline auto put_u64(std::string& out, const uint64_t& value) -> void {
+    for (size_t i{0}; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+// length prefixed byte string
+inline auto put_bytes(std::string& out, const std::string& bytes) -> void {
+    put_u32(out, static_cast<uint32_t>(bytes.size()));
+    out += bytes;
+}
+
+inline auto get_u32(const std::string& in, size_t& pos) -> uint32_t {
+    if (in.size() < 4 || pos > in.size() - 4) throw std::runtime_error("wire: truncated u32");
+    uint32_t value{0};
+    for (size_t i{0}; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<unsigned char>(in[pos++])) << (8 * i);
+    return value;
+}
+
+inline auto get_u64(const std::string& in, size_t& pos) -> uint64_t {
+    if (in.size() < 8 || pos > in.size() - 8) throw std::runtime_error("wire: truncated u64");
+    uint64_t value{0};
+    for (size_t i{0}; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(in[pos++])) << (8 * i);
+    return value;
+}
+
+inline auto get_bytes(const std::string& in, size_t& pos) -> std::string {
+    const auto len{get_u32(in, pos)};
+    if (len > in.size() - pos) throw std::runtime_error("wire: truncated bytes");
+    auto bytes{in.substr(pos, len)};
+    pos += len;
+    return bytes;
+}
+
+// value of each hex digit (-1 for other characters), a table avoids a
+// mispredicted branch per digit (digits and letters are equally likely)
+constexpr auto make_hex_values() -> std::array<int8_t, 256> {
+    std::array<int8_t, 256> values{};
+    for (auto& v : values) v = -1;
+    for (int c{0}; c < 10; ++c) values['0' + c] = static_cast<int8_t>(c);
+    for (int c{0}; c < 6; ++c) values['a' + c] = values['A' + c] = static_cast<int8_t>(10 + c);
+    return values;
+}
+inline constexpr auto hex_values{make_hex_values()};
+
+// write the 32 raw bytes of a hex hash (zeros if it is not a SHA-256 hash)
+inline auto hash_to_bytes(const std::string& hash, uint8_t* out) -> void {
+    int invalid{hash.size() != 64};
+    for (size_t i{0}; i < 32 && !invalid; ++i) {
+        const auto hi{hex_values[static_cast<uint8_t>(hash[2 * i])]};
+        const auto lo{hex_values[static_cast<uint8_t>(hash[2 * i + 1])]};
+        invalid |= (hi | lo) < 0;
+        out[i] = static_cast<uint8_t>((hi << 4) | (lo & 0xF));
+    }
+    if (invalid) std::memset(out, 0, 32);
+}
+
+// lowercase hex of 32 raw hash bytes
+inline auto bytes_to_hash(const uint8_t* bytes) -> std::string {
+    static constexpr char digits[]{"0123456789abcdef"};
+    std::string hash(64, '0');
+    for (size_t i{0}; i < 32; ++i) {
+        hash[2 * i] = digits[bytes[i] >> 4];
+        hash[2 * i + 1] = digits[bytes[i] & 0xF];
+    }
+    return hash;
+}
+
+#endif // WIRE_HEADER_FILE
@@ -0,0 +1,3 @@
+// doctest entry point for the engine unit tests (the tests live in the src files)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"